@@ -0,0 +1,151 @@
+#pragma once
+#include <cmath>
+#include <type_traits>
+
+// Exact num / den * 10^exp10. num and den are integers a double holds exactly (unitgen
+// checks this), so the value is rounded once, when coefficients are folded.
+struct Ratio {
+    double num;
+    double den = 1.0;
+    int exp10 = 0;
+
+    constexpr double value() const;
+};
+
+// to = value * scale + offset, evaluated as a single fused multiply-add
+struct Affine {
+    double scale = 1.0;
+    double offset = 0.0;
+
+    constexpr double apply(double value) const noexcept
+    {
+        if (std::is_constant_evaluated()) return value * scale + offset;
+        return std::fma(value, scale, offset);
+    }
+};
+
+// Double-double arithmetic (value = hi + lo, ~106 bits) so folded coefficients are
+// rounded to double once, at the end. Without it 32 F -> C comes out as 7e-15, not 0.
+namespace affine_detail {
+
+struct DD {
+    double hi;
+    double lo;
+};
+
+constexpr DD quickTwoSum(double a, double b)
+{
+    const double s = a + b;
+    return { s, b - (s - a) };
+}
+
+constexpr DD twoSum(double a, double b)
+{
+    const double s = a + b;
+    const double bb = s - a;
+    return { s, (a - (s - bb)) + (b - bb) };
+}
+
+constexpr DD split(double a)
+{
+    const double t = 134217729.0 * a; // 2^27 + 1
+    const double hi = t - (t - a);
+    return { hi, a - hi };
+}
+
+constexpr DD twoProd(double a, double b)
+{
+    const double p = a * b;
+    const DD as = split(a);
+    const DD bs = split(b);
+    return { p, ((as.hi * bs.hi - p) + as.hi * bs.lo + as.lo * bs.hi) + as.lo * bs.lo };
+}
+
+constexpr DD ddSub(DD a, DD b)
+{
+    const DD s = twoSum(a.hi, -b.hi);
+    return quickTwoSum(s.hi, s.lo + (a.lo - b.lo));
+}
+
+constexpr DD ddMul(DD a, double b)
+{
+    const DD p = twoProd(a.hi, b);
+    return quickTwoSum(p.hi, p.lo + a.lo * b);
+}
+
+constexpr DD ddDiv(DD a, double b)
+{
+    const double q1 = a.hi / b;
+    const DD r1 = ddSub(a, twoProd(q1, b));
+    const double q2 = r1.hi / b;
+    const DD r2 = ddSub(r1, twoProd(q2, b));
+    const double q3 = r2.hi / b;
+    const DD q = quickTwoSum(q1, q2);
+    return quickTwoSum(q.hi, q.lo + q3);
+}
+
+// Powers of ten up to 1e22 are exact doubles; larger exponents are applied in steps.
+inline constexpr double kExactPow10[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+constexpr DD ddScalePow10(DD v, int exp10)
+{
+    while (exp10 > 0) {
+        const int step = exp10 < 22 ? exp10 : 22;
+        v = ddMul(v, kExactPow10[step]);
+        exp10 -= step;
+    }
+    while (exp10 < 0) {
+        const int step = -exp10 < 22 ? -exp10 : 22;
+        v = ddDiv(v, kExactPow10[step]);
+        exp10 += step;
+    }
+    return v;
+}
+
+constexpr DD ddRatio(const Ratio& r)
+{
+    return ddScalePow10(ddDiv({ r.num, 0.0 }, r.den), r.exp10);
+}
+
+} // namespace affine_detail
+
+constexpr double Ratio::value() const
+{
+    return affine_detail::ddRatio(*this).hi;
+}
+
+// foldAffine before its final rounding, for callers that bound their own error
+// (decimalconvert.h): both coefficients to ~100 bits.
+struct AffineDD {
+    affine_detail::DD scale;
+    affine_detail::DD offset;
+};
+
+// from -> base -> to, folded: to = v * (s1 / s2) + (o1 - o2) / s2. U is any unit
+// description with Ratio scale and offset members (UnitInfo, or unitgen's parse result).
+template <typename U>
+constexpr AffineDD foldAffineDD(const U& from, const U& to)
+{
+    using namespace affine_detail;
+
+    AffineDD a;
+    // s1 / s2 = (n1 * d2) / (d1 * n2) * 10^(e1 - e2)
+    const DD num = twoProd(from.scale.num, to.scale.den);
+    const DD den = twoProd(from.scale.den, to.scale.num);
+    const DD q = ddDiv(num, den.hi);
+    a.scale = ddScalePow10(ddSub(q, ddDiv(ddMul(q, den.lo), den.hi)), from.scale.exp10 - to.scale.exp10);
+
+    const DD diff = ddSub(ddRatio(from.offset), ddRatio(to.offset));
+    a.offset = ddScalePow10(ddDiv(ddMul(diff, to.scale.den), to.scale.num), -to.scale.exp10);
+    return a;
+}
+
+template <typename U>
+constexpr Affine foldAffine(const U& from, const U& to)
+{
+    const AffineDD a = foldAffineDD(from, to);
+    return { a.scale.hi, a.offset.hi };
+}
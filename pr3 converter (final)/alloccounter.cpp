@@ -0,0 +1,67 @@
+#include "alloccounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<std::uint64_t> g_allocations{0};
+
+static void countAllocation()
+{
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::uint64_t allocationCount()
+{
+    return g_allocations.load(std::memory_order_relaxed);
+}
+
+#if defined(__GLIBC__)
+
+// Qt allocates QString/QByteArray storage with malloc, not operator new, so on glibc
+// the C allocator itself is wrapped; operator new ends up here as well.
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* ptr, std::size_t size);
+
+void* malloc(std::size_t size)
+{
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t count, std::size_t size)
+{
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* ptr, std::size_t size)
+{
+    countAllocation();
+    return __libc_realloc(ptr, size);
+}
+}
+
+#else
+
+// Elsewhere only C++ allocations are seen.
+void* operator new(std::size_t size)
+{
+    countAllocation();
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+
+#endif
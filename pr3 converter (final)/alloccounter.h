@@ -0,0 +1,6 @@
+#pragma once
+#include <cstdint>
+
+// Heap allocations made by the process so far. Only available when the build sets
+// CONVERTER_ALLOC_TRACE (cmake -DCONVERTER_ALLOC_TRACE=ON), which links alloccounter.cpp.
+std::uint64_t allocationCount();
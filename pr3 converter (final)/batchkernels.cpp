@@ -0,0 +1,260 @@
+#include "batchkernels.h"
+#include <cmath>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CONVERTER_X86_KERNELS 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define CONVERTER_TARGET(features)
+#else
+#define CONVERTER_TARGET(features) __attribute__((target(features)))
+#endif
+#endif
+
+namespace {
+
+using DoubleKernel = void (*)(const double*, double*, std::size_t, double, double);
+using FloatKernel = void (*)(const float*, float*, std::size_t, double, double);
+using FanOutKernel = void (*)(double, const double*, double*, std::size_t);
+
+struct KernelSet {
+    DoubleKernel f64;
+    FloatKernel f32;
+    FanOutKernel fanOut;
+    const char* name;
+};
+
+// ----- scalar: reference rounding, also used for loop tails -----
+void scalarF64(const double* in, double* out, std::size_t n, double scale, double offset)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = std::fma(in[i], scale, offset);
+}
+
+void scalarF32(const float* in, float* out, std::size_t n, double scale, double offset)
+{
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = static_cast<float>(std::fma(static_cast<double>(in[i]), scale, offset));
+}
+
+void scalarFanOut(double value, const double* coeffs, double* out, std::size_t n)
+{
+    for (std::size_t j = 0; j < n; ++j)
+        out[j] = std::fma(value, coeffs[2 * j], coeffs[2 * j + 1]);
+}
+
+#ifdef CONVERTER_X86_KERNELS
+
+// ----- SSE2: no fused multiply-add, so only pure scale factors are vectorized.
+// With a zero offset, mul followed by add of that zero rounds exactly like fma
+// (including the sign of zero); anything else goes through the scalar path.
+void sse2F64(const double* in, double* out, std::size_t n, double scale, double offset)
+{
+    if (offset != 0.0) { scalarF64(in, out, n, scale, offset); return; }
+
+    const __m128d s = _mm_set1_pd(scale);
+    const __m128d o = _mm_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128d a = _mm_loadu_pd(in + i);
+        const __m128d b = _mm_loadu_pd(in + i + 2);
+        _mm_storeu_pd(out + i,     _mm_add_pd(_mm_mul_pd(a, s), o));
+        _mm_storeu_pd(out + i + 2, _mm_add_pd(_mm_mul_pd(b, s), o));
+    }
+    scalarF64(in + i, out + i, n - i, scale, offset);
+}
+
+void sse2F32(const float* in, float* out, std::size_t n, double scale, double offset)
+{
+    if (offset != 0.0) { scalarF32(in, out, n, scale, offset); return; }
+
+    const __m128d s = _mm_set1_pd(scale);
+    const __m128d o = _mm_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const __m128 x = _mm_loadu_ps(in + i);
+        const __m128d lo = _mm_cvtps_pd(x);
+        const __m128d hi = _mm_cvtps_pd(_mm_movehl_ps(x, x));
+        const __m128 rlo = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(lo, s), o));
+        const __m128 rhi = _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(hi, s), o));
+        _mm_storeu_ps(out + i, _mm_movelh_ps(rlo, rhi));
+    }
+    scalarF32(in + i, out + i, n - i, scale, offset);
+}
+
+// ----- AVX2 + FMA -----
+CONVERTER_TARGET("avx2,fma")
+void avx2F64(const double* in, double* out, std::size_t n, double scale, double offset)
+{
+    const __m256d s = _mm256_set1_pd(scale);
+    const __m256d o = _mm256_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256d a = _mm256_loadu_pd(in + i);
+        const __m256d b = _mm256_loadu_pd(in + i + 4);
+        _mm256_storeu_pd(out + i,     _mm256_fmadd_pd(a, s, o));
+        _mm256_storeu_pd(out + i + 4, _mm256_fmadd_pd(b, s, o));
+    }
+    for (; i < n; ++i)
+        out[i] = std::fma(in[i], scale, offset);
+}
+
+CONVERTER_TARGET("avx2,fma")
+void avx2F32(const float* in, float* out, std::size_t n, double scale, double offset)
+{
+    const __m256d s = _mm256_set1_pd(scale);
+    const __m256d o = _mm256_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        const __m256 x = _mm256_loadu_ps(in + i);
+        const __m256d lo = _mm256_cvtps_pd(_mm256_castps256_ps128(x));
+        const __m256d hi = _mm256_cvtps_pd(_mm256_extractf128_ps(x, 1));
+        const __m128 rlo = _mm256_cvtpd_ps(_mm256_fmadd_pd(lo, s, o));
+        const __m128 rhi = _mm256_cvtpd_ps(_mm256_fmadd_pd(hi, s, o));
+        _mm256_storeu_ps(out + i, _mm256_set_m128(rhi, rlo));
+    }
+    for (; i < n; ++i)
+        out[i] = static_cast<float>(std::fma(static_cast<double>(in[i]), scale, offset));
+}
+
+// Two loads hold pairs 0..3; unpacking gives scales and offsets in order 0 2 1 3,
+// which the final permute puts back.
+CONVERTER_TARGET("avx2,fma")
+void avx2FanOut(double value, const double* coeffs, double* out, std::size_t n)
+{
+    const __m256d v = _mm256_set1_pd(value);
+    std::size_t j = 0;
+    for (; j + 4 <= n; j += 4) {
+        const __m256d a = _mm256_loadu_pd(coeffs + 2 * j);
+        const __m256d b = _mm256_loadu_pd(coeffs + 2 * j + 4);
+        const __m256d r = _mm256_fmadd_pd(v, _mm256_unpacklo_pd(a, b), _mm256_unpackhi_pd(a, b));
+        _mm256_storeu_pd(out + j, _mm256_permute4x64_pd(r, _MM_SHUFFLE(3, 1, 2, 0)));
+    }
+    scalarFanOut(value, coeffs + 2 * j, out + j, n - j);
+}
+
+// ----- AVX-512F -----
+CONVERTER_TARGET("avx512f")
+void avx512F64(const double* in, double* out, std::size_t n, double scale, double offset)
+{
+    const __m512d s = _mm512_set1_pd(scale);
+    const __m512d o = _mm512_set1_pd(offset);
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        const __m512d a = _mm512_loadu_pd(in + i);
+        const __m512d b = _mm512_loadu_pd(in + i + 8);
+        _mm512_storeu_pd(out + i,     _mm512_fmadd_pd(a, s, o));
+        _mm512_storeu_pd(out + i + 8, _mm512_fmadd_pd(b, s, o));
+    }
+    for (; i < n; ++i)
+        out[i] = std::fma(in[i], scale, offset);
+}
+
+CONVERTER_TARGET("avx512f")
+void avx512F32(const float* in, float* out, std::size_t n, double scale, double offset)
+{
+    const __m512d s = _mm512_set1_pd(scale);
+    const __m512d o = _mm512_set1_pd(offset);
+    std::size_t i = 0;
+    // the all-lanes maskz forms of the conversions: GCC 12's plain ones pass an
+    // _mm512_undefined_pd() source that -Wall reports as maybe-uninitialized
+    const __mmask8 all = 0xff;
+    for (; i + 8 <= n; i += 8) {
+        const __m512d x = _mm512_maskz_cvtps_pd(all, _mm256_loadu_ps(in + i));
+        _mm256_storeu_ps(out + i, _mm512_maskz_cvtpd_ps(all, _mm512_fmadd_pd(x, s, o)));
+    }
+    for (; i < n; ++i)
+        out[i] = static_cast<float>(std::fma(static_cast<double>(in[i]), scale, offset));
+}
+
+CONVERTER_TARGET("avx512f")
+void avx512FanOut(double value, const double* coeffs, double* out, std::size_t n)
+{
+    const __m512d v = _mm512_set1_pd(value);
+    const __m512i scales = _mm512_set_epi64(14, 12, 10, 8, 6, 4, 2, 0);
+    const __m512i offsets = _mm512_set_epi64(15, 13, 11, 9, 7, 5, 3, 1);
+    std::size_t j = 0;
+    for (; j + 8 <= n; j += 8) {
+        const __m512d a = _mm512_loadu_pd(coeffs + 2 * j);
+        const __m512d b = _mm512_loadu_pd(coeffs + 2 * j + 8);
+        _mm512_storeu_pd(out + j, _mm512_fmadd_pd(v, _mm512_permutex2var_pd(a, scales, b),
+                                                  _mm512_permutex2var_pd(a, offsets, b)));
+    }
+    scalarFanOut(value, coeffs + 2 * j, out + j, n - j);
+}
+
+struct CpuFeatures {
+    bool avx2Fma = false;
+    bool avx512f = false;
+};
+
+CpuFeatures detectCpu()
+{
+    CpuFeatures f;
+#if defined(_MSC_VER) && !defined(__clang__)
+    int r[4];
+    __cpuid(r, 0);
+    const int maxLeaf = r[0];
+    __cpuid(r, 1);
+    const bool osxsave = (r[2] & (1 << 27)) != 0;
+    const bool fma = (r[2] & (1 << 12)) != 0;
+    if (!osxsave || maxLeaf < 7) return f;
+    const unsigned long long xcr0 = _xgetbv(0);
+    const bool ymmState = (xcr0 & 0x6) == 0x6;
+    const bool zmmState = (xcr0 & 0xE6) == 0xE6;
+    __cpuidex(r, 7, 0);
+    f.avx2Fma = ymmState && fma && (r[1] & (1 << 5)) != 0;
+    f.avx512f = zmmState && (r[1] & (1 << 16)) != 0;
+#else
+    __builtin_cpu_init();
+    f.avx2Fma = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    f.avx512f = __builtin_cpu_supports("avx512f");
+#endif
+    return f;
+}
+
+KernelSet pickKernels()
+{
+    const CpuFeatures f = detectCpu();
+    if (f.avx512f) return { avx512F64, avx512F32, avx512FanOut, "avx512" };
+    if (f.avx2Fma) return { avx2F64, avx2F32, avx2FanOut, "avx2" };
+    return { sse2F64, sse2F32, scalarFanOut, "sse2" };
+}
+
+#else
+
+KernelSet pickKernels()
+{
+    return { scalarF64, scalarF32, scalarFanOut, "scalar" };
+}
+
+#endif // CONVERTER_X86_KERNELS
+
+const KernelSet& kernels()
+{
+    static const KernelSet k = pickKernels();
+    return k;
+}
+
+} // namespace
+
+void affineBatch(const double* in, double* out, std::size_t n, double scale, double offset)
+{
+    kernels().f64(in, out, n, scale, offset);
+}
+
+void affineBatch(const float* in, float* out, std::size_t n, double scale, double offset)
+{
+    kernels().f32(in, out, n, scale, offset);
+}
+
+void affineFanOut(double value, const double* coeffs, double* out, std::size_t n)
+{
+    kernels().fanOut(value, coeffs, out, n);
+}
+
+const char* affineBatchKernelName()
+{
+    return kernels().name;
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstddef>
+
+// out[i] = fma(in[i], scale, offset) over n elements. in and out may be the same buffer,
+// but must not partially overlap. The kernel (scalar, SSE2, AVX2+FMA or AVX-512F) is picked
+// once per process from the CPU's features; every kernel rounds exactly like std::fma.
+void affineBatch(const double* in, double* out, std::size_t n, double scale, double offset);
+
+// float data is widened to double, fused in double and rounded back to float once.
+void affineBatch(const float* in, float* out, std::size_t n, double scale, double offset);
+
+// out[j] = fma(value, coeffs[2j], coeffs[2j + 1]) over n elements: one value through n
+// interleaved (scale, offset) pairs, such as a row of Converter's fused table. Same kernel
+// choice and rounding as affineBatch (SSE2 has no fma, so it uses the scalar loop here).
+void affineFanOut(double value, const double* coeffs, double* out, std::size_t n);
+
+// Name of the kernel picked for this CPU ("scalar", "sse2", "avx2", "avx512").
+const char* affineBatchKernelName();
@@ -0,0 +1,59 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+// Multi-producer, multi-consumer FIFO between pipeline stages. push() blocks while the queue
+// holds capacity items, so a slow stage holds back the ones before it instead of letting
+// work pile up in memory; close() ends the stream once what is queued has been taken.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity) : capacity_(capacity ? capacity : 1) {}
+
+    // False (and item dropped) if the queue was closed.
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notFull_.wait(lock, [&]{ return closed_ || items_.size() < capacity_; });
+        if (closed_) return false;
+        items_.push_back(std::move(item));
+        lock.unlock();
+        notEmpty_.notify_one();
+        return true;
+    }
+
+    // Blocks until an item is available; false once the queue is closed and empty.
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        notEmpty_.wait(lock, [&]{ return closed_ || !items_.empty(); });
+        if (items_.empty()) return false;
+        item = std::move(items_.front());
+        items_.pop_front();
+        lock.unlock();
+        notFull_.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        notEmpty_.notify_all();
+        notFull_.notify_all();
+    }
+
+private:
+    const std::size_t capacity_;
+    std::mutex mutex_;
+    std::condition_variable notEmpty_;
+    std::condition_variable notFull_;
+    std::deque<T> items_;
+    bool closed_ = false;
+};
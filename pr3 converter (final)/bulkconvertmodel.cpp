@@ -0,0 +1,68 @@
+#include "bulkconvertmodel.h"
+#include "numbertext.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <utility>
+
+BulkConvertModel::BulkConvertModel(QObject *parent)
+    : QAbstractTableModel(parent)
+{
+}
+
+int BulkConvertModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid() || !inputs_) return 0;
+    // views address rows by int; anything past that is exported but not shown
+    return int(std::min<std::size_t>(inputs_->size(), INT_MAX));
+}
+
+int BulkConvertModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant BulkConvertModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid()) return {};
+    if (role == Qt::TextAlignmentRole) return QVariant::fromValue(Qt::AlignRight | Qt::AlignVCenter);
+    if (role != Qt::DisplayRole) return {};
+    return cellText(index.column() == InputColumn ? inputs_ : results_, index.row());
+}
+
+QVariant BulkConvertModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+    return section == InputColumn ? tr("Input") : tr("Result");
+}
+
+QString BulkConvertModel::cellText(const Values& values, int row)
+{
+    if (!values || row < 0 || std::size_t(row) >= values->size()) return {};
+    const double v = (*values)[std::size_t(row)];
+    if (std::isnan(v)) return {};
+    char buf[kMaxNumberChars];
+    const char* end = formatNumber(v, buf);
+    return QString::fromLatin1(buf, qsizetype(end - buf));
+}
+
+void BulkConvertModel::setValues(Values inputs, Values results, UnitId from, UnitId to)
+{
+    beginResetModel();
+    inputs_ = std::move(inputs);
+    results_ = std::move(results);
+    resultFrom_ = from;
+    resultTo_ = to;
+    endResetModel();
+}
+
+void BulkConvertModel::setResults(Values results, UnitId from, UnitId to)
+{
+    results_ = std::move(results);
+    resultFrom_ = from;
+    resultTo_ = to;
+    const int rows = rowCount();
+    // views re-query only what they show, so one range for the whole column is cheap
+    if (rows > 0) emit dataChanged(index(0, ResultColumn), index(rows - 1, ResultColumn), { Qt::DisplayRole });
+}
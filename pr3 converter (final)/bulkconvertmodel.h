@@ -0,0 +1,54 @@
+#ifndef BULKCONVERTMODEL_H
+#define BULKCONVERTMODEL_H
+
+#include <QAbstractTableModel>
+
+#include <memory>
+#include <vector>
+
+#include "unitregistry.h"
+
+// A column of inputs beside their converted results, for millions of rows. The model only
+// holds the two arrays (shared with the thread that filled them, never written again);
+// a row's text is formatted in data(), so only the rows a view shows are ever materialized.
+// NaN (an input that was not a number) shows as an empty cell.
+class BulkConvertModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { InputColumn, ResultColumn, ColumnCount };
+
+    using Values = std::shared_ptr<const std::vector<double>>;
+
+    explicit BulkConvertModel(QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // New inputs: resets the model. results, converted from -> to, may be null until
+    // converted, and must otherwise be as long as inputs.
+    void setValues(Values inputs, Values results, UnitId from = UnitId::Invalid, UnitId to = UnitId::Invalid);
+    // New results for the current inputs (null while a conversion runs): only the result
+    // column changes.
+    void setResults(Values results, UnitId from = UnitId::Invalid, UnitId to = UnitId::Invalid);
+
+    const Values& inputs() const { return inputs_; }
+    const Values& results() const { return results_; }
+    // The units results() were converted between; whatever the page's combos say now.
+    UnitId resultFrom() const { return resultFrom_; }
+    UnitId resultTo() const { return resultTo_; }
+
+    // The column's text for row; empty for NaN or a row without a result.
+    static QString cellText(const Values& values, int row);
+
+private:
+    Values inputs_;
+    Values results_;
+    UnitId resultFrom_ = UnitId::Invalid;
+    UnitId resultTo_ = UnitId::Invalid;
+};
+
+#endif // BULKCONVERTMODEL_H
@@ -0,0 +1,341 @@
+#include "bulkconvertpage.h"
+#include "converter.h"
+#include "numbertext.h"
+#include "streamconvert.h"
+#include "unitlistmodel.h"
+
+#include <QApplication>
+#include <QBoxLayout>
+#include <QClipboard>
+#include <QComboBox>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QItemSelectionModel>
+#include <QLabel>
+#include <QLocale>
+#include <QPushButton>
+#include <QSaveFile>
+#include <QSignalBlocker>
+#include <QTableView>
+#include <QThread>
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace {
+
+// Rows written per QSaveFile::write while exporting.
+constexpr std::size_t kExportRowsPerWrite = 1 << 14;
+
+QString unitKey(UnitId id)
+{
+    const std::string_view key = unitInfo(id).key;
+    return QString::fromUtf8(key.data(), qsizetype(key.size()));
+}
+
+BulkConvertModel::Values convertAll(UnitMode mode, UnitId from, UnitId to, const std::optional<DecimalRounding>& rounding,
+                                    const std::vector<double>& in)
+{
+    auto out = std::make_shared<std::vector<double>>(in.size());
+    if (Converter::convertBatch(mode, from, to, in, *out) != ConvError::None) return nullptr;
+    // the batch pass above also checked the units; round from the inputs, not its results
+    if (rounding) DecimalConverter(from, to, *rounding).convert(in, *out);
+    return out;
+}
+
+// Appends the value's text (nothing for NaN) to line.
+void appendNumber(QByteArray& line, double v)
+{
+    if (v != v) return;
+    char buf[kMaxNumberChars];
+    const char* end = formatNumber(v, buf);
+    line.append(buf, qsizetype(end - buf));
+}
+
+} // namespace
+
+BulkConvertPage::BulkConvertPage(QWidget *parent)
+    : QWidget(parent)
+    , model_(new BulkConvertModel(this))
+{
+    auto* open = new QPushButton(tr("&Open..."), this);
+    auto* paste = new QPushButton(tr("&Paste"), this);
+    mode_ = new QComboBox(this);
+    from_ = new QComboBox(this);
+    to_ = new QComboBox(this);
+    copy_ = new QPushButton(tr("&Copy"), this);
+    export_ = new QPushButton(tr("&Export..."), this);
+    status_ = new QLabel(tr("Open or paste a column of numbers."), this);
+    view_ = new QTableView(this);
+
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        const std::string_view name = unitModeName(static_cast<UnitMode>(m));
+        mode_->addItem(QString::fromUtf8(name.data(), qsizetype(name.size())));
+    }
+    copy_->setEnabled(false);
+    export_->setEnabled(false);
+
+    view_->setModel(model_);
+    view_->verticalHeader()->hide();
+    view_->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    // uniform rows: the view places rows arithmetically and asks only visible ones for text
+    view_->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    view_->setSelectionBehavior(QAbstractItemView::SelectRows);
+
+    auto* controls = new QHBoxLayout;
+    controls->addWidget(open);
+    controls->addWidget(paste);
+    controls->addWidget(mode_);
+    controls->addWidget(from_);
+    controls->addWidget(new QLabel(QStringLiteral("→"), this));
+    controls->addWidget(to_);
+    controls->addStretch();
+    controls->addWidget(copy_);
+    controls->addWidget(export_);
+
+    auto* layout = new QVBoxLayout(this);
+    layout->addLayout(controls);
+    layout->addWidget(view_);
+    layout->addWidget(status_);
+
+    setMode(0);
+
+    connect(open, &QPushButton::clicked, this, &BulkConvertPage::openFile);
+    connect(paste, &QPushButton::clicked, this, &BulkConvertPage::pasteClipboard);
+    connect(copy_, &QPushButton::clicked, this, &BulkConvertPage::copySelection);
+    connect(export_, &QPushButton::clicked, this, &BulkConvertPage::exportResults);
+    connect(mode_, &QComboBox::currentIndexChanged, this, &BulkConvertPage::setMode);
+    connect(from_, &QComboBox::currentIndexChanged, this, &BulkConvertPage::reconvert);
+    connect(to_, &QComboBox::currentIndexChanged, this, &BulkConvertPage::reconvert);
+}
+
+BulkConvertPage::~BulkConvertPage()
+{
+    // workers post back to this page; queued posts die with it, running ones must finish first
+    for (QThread* job : jobs_) {
+        job->wait();
+        delete job;
+    }
+}
+
+void BulkConvertPage::setDecimalRounding(std::optional<DecimalRounding> rounding)
+{
+    if (rounding == rounding_) return;
+    rounding_ = rounding;
+    reconvert();
+}
+
+UnitMode BulkConvertPage::mode() const
+{
+    return static_cast<UnitMode>(std::max(mode_->currentIndex(), 0));
+}
+
+UnitId BulkConvertPage::fromUnit() const
+{
+    return units_->unitAt(from_->currentIndex());
+}
+
+UnitId BulkConvertPage::toUnit() const
+{
+    return units_->unitAt(to_->currentIndex());
+}
+
+void BulkConvertPage::setMode(int index)
+{
+    if (index < 0) return;
+    UnitListModel* old = units_;
+    units_ = new UnitListModel(static_cast<UnitMode>(index), this);
+    {
+        const QSignalBlocker blockFrom(from_);
+        const QSignalBlocker blockTo(to_);
+        from_->setModel(units_);
+        to_->setModel(units_);
+        if (units_->rowCount() > 1) to_->setCurrentIndex(1);
+    }
+    delete old;
+    reconvert();
+}
+
+void BulkConvertPage::openFile()
+{
+    const QString path = QFileDialog::getOpenFileName(this, tr("Open Numbers"), QString(),
+                                                      tr("Text files (*.txt *.csv);;All files (*)"));
+    if (path.isEmpty()) return;
+
+    load(path, [path](std::vector<double>& values, std::size_t& bad, QString& error) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            error = file.errorString();
+            return false;
+        }
+        const qint64 size = file.size();
+        if (size == 0) return true;
+        // parse straight out of the page cache; fall back to reading for pipes and the like
+        if (const uchar* data = file.map(0, size)) {
+            const char* begin = reinterpret_cast<const char*>(data);
+            parseNumberList(begin, begin + size, 0, values, bad);
+            file.unmap(const_cast<uchar*>(data));
+        } else {
+            const QByteArray bytes = file.readAll();
+            parseNumberList(bytes.constData(), bytes.constData() + bytes.size(), 0, values, bad);
+        }
+        return true;
+    });
+}
+
+void BulkConvertPage::pasteClipboard()
+{
+    // the clipboard is only safe to read here; the text is implicitly shared, not copied
+    const QString text = QApplication::clipboard()->text();
+    if (text.isEmpty()) {
+        status_->setText(tr("The clipboard has no text."));
+        return;
+    }
+    load(tr("clipboard"), [text](std::vector<double>& values, std::size_t& bad, QString&) {
+        const QByteArray utf8 = text.toUtf8();
+        parseNumberList(utf8.constData(), utf8.constData() + utf8.size(), 0, values, bad);
+        return true;
+    });
+}
+
+void BulkConvertPage::load(const QString& source, Parser parse)
+{
+    const int generation = ++loadGeneration_;
+    const UnitMode m = mode();
+    const UnitId from = fromUnit();
+    const UnitId to = toUnit();
+    const std::optional<DecimalRounding> rounding = rounding_;
+    status_->setText(tr("Reading %1...").arg(source));
+
+    startJob([this, generation, source, parse = std::move(parse), m, from, to, rounding] {
+        QElapsedTimer clock;
+        clock.start();
+        auto inputs = std::make_shared<std::vector<double>>();
+        std::size_t bad = 0;
+        QString error;
+        const bool ok = parse(*inputs, bad, error);
+        BulkConvertModel::Values results = ok ? convertAll(m, from, to, rounding, *inputs) : nullptr;
+        const qint64 ms = clock.elapsed();
+
+        QMetaObject::invokeMethod(this, [=, this, inputs = BulkConvertModel::Values(std::move(inputs))] {
+            if (generation != loadGeneration_) return;
+            if (!ok) {
+                status_->setText(tr("Cannot read %1: %2").arg(source, error));
+                return;
+            }
+            // the units or rounding changed while loading: show the inputs now, convert them again
+            const bool stale = m != mode() || from != fromUnit() || to != toUnit() || rounding != rounding_;
+            model_->setValues(inputs, stale ? nullptr : results, from, to);
+            copy_->setEnabled(!inputs->empty());
+            export_->setEnabled(!inputs->empty() && model_->results());
+
+            const QLocale locale;
+            QString message = tr("%1: %2 values in %3 ms").arg(source, locale.toString(qulonglong(inputs->size()))).arg(ms);
+            if (bad) message += tr(", %1 not numbers (left blank)").arg(locale.toString(qulonglong(bad)));
+            if (model_->rowCount() < qsizetype(inputs->size()))
+                message += tr("; showing the first %1").arg(locale.toString(model_->rowCount()));
+            status_->setText(message);
+            if (stale) reconvert();
+        }, Qt::QueuedConnection);
+    });
+}
+
+void BulkConvertPage::reconvert()
+{
+    const BulkConvertModel::Values inputs = model_->inputs();
+    if (!inputs) return;
+    const int generation = ++convertGeneration_;
+    const UnitMode m = mode();
+    const UnitId from = fromUnit();
+    const UnitId to = toUnit();
+    const std::optional<DecimalRounding> rounding = rounding_;
+
+    // the old results belong to the old units: blank them until the new ones arrive
+    model_->setResults(nullptr);
+    export_->setEnabled(false);
+
+    startJob([this, generation, inputs, m, from, to, rounding] {
+        BulkConvertModel::Values results = convertAll(m, from, to, rounding, *inputs);
+        QMetaObject::invokeMethod(this, [this, generation, inputs, results = std::move(results), from, to] {
+            // a newer conversion or load has replaced what this one was for
+            if (generation != convertGeneration_ || inputs != model_->inputs()) return;
+            model_->setResults(results, from, to);
+            export_->setEnabled(!inputs->empty() && results);
+        }, Qt::QueuedConnection);
+    });
+}
+
+void BulkConvertPage::copySelection()
+{
+    const BulkConvertModel::Values& inputs = model_->inputs();
+    const BulkConvertModel::Values& results = model_->results();
+    if (!inputs) return;
+
+    // selected rows as "input<TAB>result" lines, read from the arrays rather than through
+    // the model so a whole-column selection never creates an index per row
+    QItemSelection selection = view_->selectionModel()->selection();
+    if (selection.isEmpty() && model_->rowCount() > 0)
+        selection.select(model_->index(0, 0), model_->index(model_->rowCount() - 1, BulkConvertModel::ColumnCount - 1));
+
+    QByteArray text;
+    for (const QItemSelectionRange& range : selection) {
+        for (int row = range.top(); row <= range.bottom(); ++row) {
+            appendNumber(text, (*inputs)[std::size_t(row)]);
+            text.append('\t');
+            if (results) appendNumber(text, (*results)[std::size_t(row)]);
+            text.append('\n');
+        }
+    }
+    QApplication::clipboard()->setText(QString::fromLatin1(text));
+}
+
+void BulkConvertPage::exportResults()
+{
+    const BulkConvertModel::Values inputs = model_->inputs();
+    const BulkConvertModel::Values results = model_->results();
+    if (!inputs || !results) return;
+
+    const QString path = QFileDialog::getSaveFileName(this, tr("Export Results"), QString(),
+                                                      tr("CSV files (*.csv);;All files (*)"));
+    if (path.isEmpty()) return;
+
+    // the units the results were converted between, which the combos may have moved on from
+    const QByteArray header = (QStringLiteral("%1,%2\n").arg(unitKey(model_->resultFrom()), unitKey(model_->resultTo()))).toUtf8();
+    status_->setText(tr("Exporting to %1...").arg(path));
+
+    startJob([this, path, header, inputs, results] {
+        // written under a temporary name and renamed on commit, so a failed export leaves
+        // any earlier file intact
+        QSaveFile file(path);
+        bool ok = file.open(QIODevice::WriteOnly) && file.write(header) == header.size();
+        QByteArray chunk;
+        for (std::size_t row = 0; ok && row < inputs->size(); ++row) {
+            appendNumber(chunk, (*inputs)[row]);
+            chunk.append(',');
+            appendNumber(chunk, (*results)[row]);
+            chunk.append('\n');
+            if ((row + 1) % kExportRowsPerWrite == 0 || row + 1 == inputs->size()) {
+                ok = file.write(chunk) == chunk.size();
+                chunk.clear();
+            }
+        }
+        ok = ok && file.commit();
+        const QString message = ok ? tr("Exported %1 rows to %2").arg(QLocale().toString(qulonglong(inputs->size())), path)
+                                   : tr("Cannot export to %1: %2").arg(path, file.errorString());
+        QMetaObject::invokeMethod(this, [this, message] { status_->setText(message); }, Qt::QueuedConnection);
+    });
+}
+
+void BulkConvertPage::startJob(std::function<void()> work)
+{
+    QThread* job = QThread::create(std::move(work));
+    jobs_.push_back(job);
+    connect(job, &QThread::finished, this, [this, job] {
+        jobs_.erase(std::find(jobs_.begin(), jobs_.end(), job));
+        job->deleteLater();
+    });
+    job->start();
+}
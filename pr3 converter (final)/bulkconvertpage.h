@@ -0,0 +1,73 @@
+#ifndef BULKCONVERTPAGE_H
+#define BULKCONVERTPAGE_H
+
+#include <QWidget>
+
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "bulkconvertmodel.h"
+#include "decimalconvert.h"
+#include "unitregistry.h"
+
+class QComboBox;
+class QLabel;
+class QPushButton;
+class QTableView;
+class QThread;
+class UnitListModel;
+
+// The "Bulk" tab: a column of numbers (opened from a file or pasted, comma- or
+// newline-separated) converted between two units of a mode. Parsing, converting and
+// exporting run on worker threads and hand finished arrays back to the GUI thread, so the
+// window stays responsive with millions of rows; the view formats only the rows it shows.
+class BulkConvertPage : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit BulkConvertPage(QWidget *parent = nullptr);
+    ~BulkConvertPage() override;
+
+    // Rounds results to decimals with DecimalConverter (View > Exact Decimals); nullopt
+    // converts as plain doubles. Converts the current inputs again.
+    void setDecimalRounding(std::optional<DecimalRounding> rounding);
+
+private:
+    QComboBox* mode_ = nullptr;
+    QComboBox* from_ = nullptr;
+    QComboBox* to_ = nullptr;
+    UnitListModel* units_ = nullptr;
+    QPushButton* copy_ = nullptr;
+    QPushButton* export_ = nullptr;
+    QLabel* status_ = nullptr;
+    QTableView* view_ = nullptr;
+    BulkConvertModel* model_ = nullptr;
+
+    std::optional<DecimalRounding> rounding_;
+
+    std::vector<QThread*> jobs_;  // running workers; the destructor waits for them
+    int loadGeneration_ = 0;      // only the newest load or conversion is shown
+    int convertGeneration_ = 0;
+
+    UnitMode mode() const;
+    UnitId fromUnit() const;
+    UnitId toUnit() const;
+
+    void setMode(int index);
+    void openFile();
+    void pasteClipboard();
+    void copySelection();
+    void exportResults();
+
+    // Runs parse (which fills values and counts fields that were not numbers) and converts
+    // the result, off the GUI thread; source names it in the status line.
+    using Parser = std::function<bool(std::vector<double>& values, std::size_t& bad, QString& error)>;
+    void load(const QString& source, Parser parse);
+    // Converts the current inputs again after a unit change.
+    void reconvert();
+    void startJob(std::function<void()> work);
+};
+
+#endif // BULKCONVERTPAGE_H
@@ -0,0 +1,100 @@
+#include "columnconvert.h"
+#include "batchkernels.h"
+#include "converter.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSysInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Below this many bytes per thread, starting threads costs more than it saves.
+constexpr qint64 kMinBytesPerThread = 4 << 20;
+
+template <typename T>
+void convertRange(const uchar* in, uchar* out, std::size_t first, std::size_t count, const Converter::Affine& a)
+{
+    affineBatch(reinterpret_cast<const T*>(in) + first, reinterpret_cast<T*>(out) + first, count, a.scale, a.offset);
+}
+
+template <typename T>
+void convertParallel(const uchar* in, uchar* out, std::size_t count, const Converter::Affine& a, int threads)
+{
+    if (threads <= 1) {
+        convertRange<T>(in, out, 0, count, a);
+        return;
+    }
+
+    // chunks are multiples of 64 elements so no two threads write the same cache line
+    const std::size_t per = (count / threads + 63) / 64 * 64;
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    std::size_t first = 0;
+    for (int t = 0; t < threads - 1 && first + per < count; ++t, first += per)
+        pool.emplace_back(convertRange<T>, in, out, first, per, std::cref(a));
+    convertRange<T>(in, out, first, count - first, a);
+    for (std::thread& th : pool) th.join();
+}
+
+} // namespace
+
+bool convertColumnFile(const QString& inPath, const QString& outPath, ColumnType type,
+                       UnitId from, UnitId to, int threads, QString& error)
+{
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+        error = "binary columns need a little-endian host";
+        return false;
+    }
+
+    // an output that is the input (by any path, symlinks resolved) converts in place:
+    // truncating it first would leave both mappings reading zeros
+    const bool inPlace = outPath.isEmpty()
+                         || QFileInfo(outPath).canonicalFilePath() == QFileInfo(inPath).canonicalFilePath();
+    const qint64 elemSize = (type == ColumnType::Float64) ? 8 : 4;
+
+    QFile in(inPath);
+    if (!in.open(inPlace ? QIODevice::ReadWrite : QIODevice::ReadOnly)) {
+        error = QString("cannot open %1: %2").arg(inPath, in.errorString());
+        return false;
+    }
+    const qint64 size = in.size();
+    if (size % elemSize != 0) {
+        error = QString("%1: size %2 is not a multiple of %3 bytes").arg(inPath).arg(size).arg(elemSize);
+        return false;
+    }
+
+    QFile out(outPath);
+    if (!inPlace) {
+        if (!out.open(QIODevice::ReadWrite | QIODevice::Truncate) || !out.resize(size)) {
+            error = QString("cannot create %1: %2").arg(outPath, out.errorString());
+            return false;
+        }
+    }
+    if (size == 0) return true;
+
+    uchar* src = in.map(0, size);
+    uchar* dst = inPlace ? src : out.map(0, size);
+    if (!src || !dst) {
+        error = QString("cannot map %1").arg(src ? outPath : inPath);
+        return false;
+    }
+
+    if (threads <= 0) threads = QThread::idealThreadCount();
+    threads = int(std::clamp<qint64>(size / kMinBytesPerThread, 1, std::max(threads, 1)));
+
+    const Converter::Affine a = Converter::coefficients(from, to);
+    const std::size_t count = std::size_t(size / elemSize);
+    if (type == ColumnType::Float64)
+        convertParallel<double>(src, dst, count, a, threads);
+    else
+        convertParallel<float>(src, dst, count, a, threads);
+
+    in.unmap(src);
+    if (!inPlace) out.unmap(dst);
+    return true;
+}
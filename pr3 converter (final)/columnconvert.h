@@ -0,0 +1,11 @@
+#pragma once
+#include <QString>
+#include "unitregistry.h"
+
+enum class ColumnType { Float64, Float32 };
+
+// Converts a flat file of little-endian float64/float32 values through memory mappings,
+// split across threads. An empty outPath, or one naming inPath itself, converts inPath in
+// place; otherwise outPath is created (or truncated) with the same size. threads <= 0 uses the ideal thread count.
+bool convertColumnFile(const QString& inPath, const QString& outPath, ColumnType type,
+                       UnitId from, UnitId to, int threads, QString& error);
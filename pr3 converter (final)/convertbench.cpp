@@ -0,0 +1,346 @@
+#include "converter.h"
+#include "batchkernels.h"
+#include "numbertext.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+struct BenchResult {
+    QString name;
+    double valuesPerSecond = 0.0;
+};
+
+volatile double g_sink = 0.0;
+
+QString unitKey(UnitId id)
+{
+    const std::string_view k = unitInfo(id).key;
+    return QString::fromUtf8(k.data(), qsizetype(k.size()));
+}
+
+QString modeKey(UnitMode mode)
+{
+    const std::string_view k = unitModeName(mode);
+    return QString::fromUtf8(k.data(), qsizetype(k.size()));
+}
+
+// Repeats fn (which converts valuesPerCall values) until minNs has passed; returns values/s.
+template <typename Fn>
+double measure(qint64 minNs, std::size_t valuesPerCall, Fn fn)
+{
+    fn(); // warm-up: page in buffers, pick the SIMD kernel
+    QElapsedTimer timer;
+    timer.start();
+    std::uint64_t calls = 0;
+    qint64 elapsed = 0;
+    do {
+        fn();
+        ++calls;
+        elapsed = timer.nsecsElapsed();
+    } while (elapsed < minNs);
+    return double(calls) * double(valuesPerCall) * 1e9 / double(elapsed ? elapsed : 1);
+}
+
+class Bench
+{
+public:
+    Bench(qint64 minNs, const QString& filter) : minNs_(minNs), filter_(filter) {}
+
+    template <typename Fn>
+    void run(const QString& name, std::size_t valuesPerCall, Fn fn)
+    {
+        if (!filter_.isEmpty() && !name.contains(filter_)) return;
+        const double vps = measure(minNs_, valuesPerCall, fn);
+        results_.push_back({ name, vps });
+        std::fprintf(stderr, "%-40s %14.0f values/s\n", qPrintable(name), vps);
+    }
+
+    const std::vector<BenchResult>& results() const { return results_; }
+
+private:
+    qint64 minNs_;
+    QString filter_;
+    std::vector<BenchResult> results_;
+};
+
+// Scalar calls see a fresh value each time so nothing is hoisted out of the loop.
+constexpr int kScalarCallsPerRound = 1024;
+
+void benchScalarPair(Bench& bench, UnitMode mode, UnitId from, UnitId to)
+{
+    const QString fromKey = unitKey(from);
+    const QString toKey = unitKey(to);
+    const QString pair = modeKey(mode) + '/' + fromKey + "->" + toKey;
+
+    bench.run("qstring/" + pair, kScalarCallsPerRound, [&]{
+        double acc = 0.0;
+        double v = 0.0;
+        for (int k = 0; k < kScalarCallsPerRound; ++k) {
+            Converter::convert(mode, double(k), fromKey, toKey, v);
+            acc += v;
+        }
+        g_sink = acc;
+    });
+
+    bench.run("id/" + pair, kScalarCallsPerRound, [&]{
+        double acc = 0.0;
+        for (int k = 0; k < kScalarCallsPerRound; ++k)
+            acc += Converter::convert(from, to, double(k));
+        g_sink = acc;
+    });
+}
+
+// Every unit to and from its mode's first unit: each key lookup and each row and column
+// of the fused tables is exercised without timing all N^2 pairs of the full catalogue.
+void benchScalar(Bench& bench)
+{
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        const UnitMode mode = static_cast<UnitMode>(m);
+        const UnitRange r = unitRange(mode);
+        const UnitId first = static_cast<UnitId>(r.first);
+        benchScalarPair(bench, mode, first, first);
+        for (std::size_t i = r.first + 1; i < r.first + r.count; ++i) {
+            benchScalarPair(bench, mode, static_cast<UnitId>(i), first);
+            benchScalarPair(bench, mode, first, static_cast<UnitId>(i));
+        }
+    }
+}
+
+void benchBatch(Bench& bench)
+{
+    // one pure-scale pair and one pair with an offset, so both SIMD paths are covered
+    const struct { UnitMode mode; UnitId from; UnitId to; } pairs[] = {
+        { UnitMode::Length, UnitId::Foot, UnitId::Meter },
+        { UnitMode::Temperature, UnitId::Fahrenheit, UnitId::Celsius },
+    };
+
+    constexpr std::size_t kMaxBatch = 10'000'000;
+    std::vector<double> in(kMaxBatch);
+    std::vector<double> out(kMaxBatch);
+    std::vector<float> inF(kMaxBatch);
+    std::vector<float> outF(kMaxBatch);
+    for (std::size_t i = 0; i < kMaxBatch; ++i) {
+        in[i] = double(i % 1000) * 0.25;
+        inF[i] = float(in[i]);
+    }
+
+    for (const auto& p : pairs) {
+        const QString pair = modeKey(p.mode) + '/' + unitKey(p.from) + "->" + unitKey(p.to);
+        for (std::size_t n = 1; n <= kMaxBatch; n *= 10) {
+            const std::span<const double> src(in.data(), n);
+            const std::span<double> dst(out.data(), n);
+            bench.run(QString("batch-f64/%1/%2").arg(pair).arg(n), n, [&]{
+                Converter::convertBatch(p.mode, p.from, p.to, src, dst);
+                g_sink = dst[n - 1];
+            });
+
+            const std::span<const float> srcF(inF.data(), n);
+            const std::span<float> dstF(outF.data(), n);
+            bench.run(QString("batch-f32/%1/%2").arg(pair).arg(n), n, [&]{
+                Converter::convertBatch(p.mode, p.from, p.to, srcF, dstF);
+                g_sink = dstF[n - 1];
+            });
+        }
+    }
+}
+
+// One value into every unit of each mode, as the all-units view does on each keystroke;
+// counted in output values.
+void benchFanOut(Bench& bench)
+{
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        const UnitMode mode = static_cast<UnitMode>(m);
+        const UnitRange r = unitRange(mode);
+        const UnitId first = static_cast<UnitId>(r.first);
+        std::vector<double> out(r.count);
+        bench.run("fanout/" + modeKey(mode) + '/' + unitKey(first), r.count * kScalarCallsPerRound, [&]{
+            double acc = 0.0;
+            for (int k = 0; k < kScalarCallsPerRound; ++k) {
+                Converter::fanOut(first, double(k), out);
+                acc += out[r.count - 1];
+            }
+            g_sink = acc;
+        });
+    }
+}
+
+// Formatting: the GUI's old QString::number(v, 'g', 10) against the shared formatter.
+void benchFormat(Bench& bench)
+{
+    constexpr int kValues = 4096;
+    std::vector<double> values(kValues);
+    for (int i = 0; i < kValues; ++i)
+        values[i] = Converter::convert(UnitId::Fahrenheit, UnitId::Celsius, i * 0.37 - 500.0);
+
+    bench.run("format/qstring-g10", kValues, [&]{
+        qsizetype len = 0;
+        for (double v : values) len += QString::number(v, 'g', 10).size();
+        g_sink = double(len);
+    });
+
+    const struct { const char* name; NumberFormat format; } styles[] = {
+        { "format/shortest", {} },
+        { "format/fixed-6", { NumberFormat::Style::Fixed, 6, 0 } },
+        { "format/significant-10", { NumberFormat::Style::Significant, 10, 0 } },
+        { "format/shortest-grouped", { NumberFormat::Style::Shortest, 0, '_' } },
+    };
+    for (const auto& s : styles) {
+        bench.run(s.name, kValues, [&]{
+            char buf[kMaxNumberChars];
+            std::size_t len = 0;
+            for (double v : values) len += std::size_t(formatNumber(v, buf, s.format) - buf);
+            g_sink = double(len);
+        });
+    }
+}
+
+QJsonDocument toJson(const std::vector<BenchResult>& results)
+{
+    QJsonArray arr;
+    for (const BenchResult& r : results) {
+        QJsonObject o;
+        o["name"] = r.name;
+        o["valuesPerSecond"] = r.valuesPerSecond;
+        arr.append(o);
+    }
+    QJsonObject root;
+    root["kernel"] = QString::fromLatin1(affineBatchKernelName());
+    root["results"] = arr;
+    return QJsonDocument(root);
+}
+
+bool writeFile(const QString& path, const QByteArray& data)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(data) != data.size()) {
+        std::fprintf(stderr, "converter-bench: cannot write %s\n", qPrintable(path));
+        return false;
+    }
+    return true;
+}
+
+// Reads the valuesPerSecond of each case in a previous JSON result; false with a message
+// if the file cannot be read or is not one.
+bool readBaseline(const QString& path, QHash<QString, double>& expected)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        std::fprintf(stderr, "converter-bench: cannot read %s\n", qPrintable(path));
+        return false;
+    }
+    QJsonParseError error;
+    const QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &error);
+    if (error.error != QJsonParseError::NoError) {
+        std::fprintf(stderr, "converter-bench: %s: %s at offset %d\n",
+                     qPrintable(path), qPrintable(error.errorString()), error.offset);
+        return false;
+    }
+    const QJsonArray arr = doc.object().value("results").toArray();
+    for (const QJsonValue& v : arr) {
+        const QJsonObject o = v.toObject();
+        const QString name = o.value("name").toString();
+        const double valuesPerSecond = o.value("valuesPerSecond").toDouble();
+        if (name.isEmpty() || !(valuesPerSecond > 0.0)) {
+            std::fprintf(stderr, "converter-bench: %s: malformed result entry\n", qPrintable(path));
+            return false;
+        }
+        expected.insert(name, valuesPerSecond);
+    }
+    if (expected.isEmpty()) {
+        std::fprintf(stderr, "converter-bench: %s has no results\n", qPrintable(path));
+        return false;
+    }
+    return true;
+}
+
+// Returns the number of results slower than expected * (1 - tolerance), or missing from it.
+int compareToBaseline(const std::vector<BenchResult>& results, const QHash<QString, double>& expected, double tolerance)
+{
+    int failures = 0;
+    for (const BenchResult& r : results) {
+        const auto it = expected.constFind(r.name);
+        if (it == expected.constEnd()) {
+            // a new case needs a new baseline, or it would never be checked
+            std::fprintf(stderr, "MISSING    %-40s not in the baseline\n", qPrintable(r.name));
+            ++failures;
+            continue;
+        }
+        const double ratio = r.valuesPerSecond / *it;
+        if (ratio < 1.0 - tolerance) {
+            std::fprintf(stderr, "REGRESSION %-40s %.0f values/s vs baseline %.0f (%.0f%%)\n",
+                         qPrintable(r.name), r.valuesPerSecond, *it, ratio * 100.0);
+            ++failures;
+        }
+    }
+    return failures;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("converter-bench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Measures Converter throughput and prints the results as JSON.\n"
+                                     "With --baseline, exits with status 1 if any case is slower than\n"
+                                     "the baseline by more than --tolerance or is missing from it.");
+    parser.addHelpOption();
+
+    const QCommandLineOption outputOpt({"o", "output"}, "Write the JSON results to file instead of stdout.", "file");
+    const QCommandLineOption baselineOpt("baseline", "Compare against a previous JSON result.", "file");
+    const QCommandLineOption toleranceOpt("tolerance", "Allowed slowdown as a fraction (default 0.15).", "fraction", "0.15");
+    const QCommandLineOption minTimeOpt("min-time", "Minimum run time per case in ms (default 50).", "ms", "50");
+    const QCommandLineOption filterOpt("filter", "Only run cases whose name contains text.", "text");
+    parser.addOption(outputOpt);
+    parser.addOption(baselineOpt);
+    parser.addOption(toleranceOpt);
+    parser.addOption(minTimeOpt);
+    parser.addOption(filterOpt);
+    parser.process(app);
+
+    bool ok = false;
+    const double tolerance = parser.value(toleranceOpt).toDouble(&ok);
+    if (!ok || tolerance < 0.0 || tolerance >= 1.0) {
+        std::fprintf(stderr, "converter-bench: --tolerance must be a fraction from 0 to below 1\n");
+        return 2;
+    }
+
+    std::fprintf(stderr, "SIMD kernel: %s\n", affineBatchKernelName());
+
+    Bench bench(qint64(parser.value(minTimeOpt).toInt()) * 1000000, parser.value(filterOpt));
+    benchScalar(bench);
+    benchBatch(bench);
+    benchFanOut(bench);
+    benchFormat(bench);
+
+    const QByteArray json = toJson(bench.results()).toJson();
+    if (parser.isSet(outputOpt)) {
+        if (!writeFile(parser.value(outputOpt), json)) return 2;
+    } else {
+        std::fwrite(json.constData(), 1, std::size_t(json.size()), stdout);
+    }
+
+    if (parser.isSet(baselineOpt)) {
+        QHash<QString, double> expected;
+        if (!readBaseline(parser.value(baselineOpt), expected)) return 2;
+        const int failures = compareToBaseline(bench.results(), expected, tolerance);
+        if (failures) {
+            std::fprintf(stderr, "converter-bench: %d case(s) regressed or missing from the baseline\n", failures);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,373 @@
+#include "converter.h"
+#include "columnconvert.h"
+#include "csvconvert.h"
+#include "jsonconvert.h"
+#include "streamconvert.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QFile>
+
+#include <cstdio>
+
+static UnitId unitFromOption(const QCommandLineParser& parser, const QCommandLineOption& opt)
+{
+    const QString key = parser.value(opt);
+    const UnitId id = Converter::unitId(key);
+    if (!isValidUnit(id))
+        std::fprintf(stderr, "convert-cli: unknown unit '%s'\n", qPrintable(key));
+    return id;
+}
+
+// Empty path or "-" means stdin.
+static std::FILE* openInput(const QString& path)
+{
+    if (path.isEmpty() || path == "-") return stdin;
+    std::FILE* in = std::fopen(QFile::encodeName(path).constData(), "rb");
+    if (!in) std::fprintf(stderr, "convert-cli: cannot open %s\n", qPrintable(path));
+    return in;
+}
+
+static int runText(const QString& path, UnitId from, UnitId to, const NumberFormat& format, bool exact)
+{
+    std::FILE* in = openInput(path);
+    if (!in) return 1;
+
+    std::string error;
+    bool ok = convertTextStream(in, stdout, from, to, error, format, exact);
+    if (in != stdin) std::fclose(in);
+    if (ok && std::fflush(stdout) != 0) {
+        ok = false;
+        error = "write failed";
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "convert-cli: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+static int runTimestamps(const QString& path, const QString& fromSpec, const QString& toSpec)
+{
+    TimestampFormat from;
+    TimestampFormat to;
+    QString formatError;
+    if (!parseTimestampFormat(fromSpec, from, formatError) || !parseTimestampFormat(toSpec, to, formatError)) {
+        std::fprintf(stderr, "convert-cli: %s\n", qPrintable(formatError));
+        return 2;
+    }
+
+    std::FILE* in = openInput(path);
+    if (!in) return 1;
+
+    std::string error;
+    bool ok = convertTimestampStream(in, stdout, from, to, error);
+    if (in != stdin) std::fclose(in);
+    if (ok && std::fflush(stdout) != 0) {
+        ok = false;
+        error = "write failed";
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "convert-cli: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
+
+// A --column value is NAME or NAME:FROM:TO; without units the --from/--to pair applies.
+static bool parseColumnSpec(const QString& spec, UnitId from, UnitId to, CsvColumn& column)
+{
+    const QStringList parts = spec.split(':');
+    if (parts.size() == 3) {
+        column.name = parts.at(0);
+        column.from = Converter::unitId(parts.at(1));
+        column.to = Converter::unitId(parts.at(2));
+    } else {
+        column.name = spec;
+        column.from = from;
+        column.to = to;
+    }
+    if (!isValidUnit(column.from) || !isValidUnit(column.to)
+        || unitInfo(column.from).mode != unitInfo(column.to).mode) {
+        std::fprintf(stderr, "convert-cli: no valid unit pair for column '%s'\n", qPrintable(column.name));
+        return false;
+    }
+    return true;
+}
+
+static int runCsv(const QString& path, const QStringList& specs, int threads, UnitId from, UnitId to,
+                  const NumberFormat& format)
+{
+    std::vector<CsvColumn> columns;
+    for (const QString& spec : specs) {
+        CsvColumn c;
+        if (!parseColumnSpec(spec, from, to, c)) return 2;
+        columns.push_back(c);
+    }
+
+    std::FILE* in = openInput(path);
+    if (!in) return 1;
+
+    std::uint64_t skipped = 0;
+    QString error;
+    bool ok = convertCsvStream(in, stdout, columns, threads, skipped, error, format);
+    if (in != stdin) std::fclose(in);
+    if (ok && std::fflush(stdout) != 0) {
+        ok = false;
+        error = "write failed";
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "convert-cli: %s\n", qPrintable(error));
+        return 1;
+    }
+    if (skipped)
+        std::fprintf(stderr, "convert-cli: %llu non-numeric fields left unchanged\n",
+                     static_cast<unsigned long long>(skipped));
+    return 0;
+}
+
+// A --json value is PATH or PATH:FROM:TO (the path itself may contain ':').
+static bool parseJsonSpec(const QString& spec, UnitId from, UnitId to, JsonField& field)
+{
+    const QStringList parts = spec.split(':');
+    field.from = from;
+    field.to = to;
+    field.path = spec;
+    if (parts.size() >= 3) {
+        const UnitId f = Converter::unitId(parts.at(parts.size() - 2));
+        const UnitId t = Converter::unitId(parts.last());
+        if (isValidUnit(f) && isValidUnit(t)) {
+            field.from = f;
+            field.to = t;
+            field.path = parts.mid(0, parts.size() - 2).join(':');
+        }
+    }
+    if (!isValidUnit(field.from) || !isValidUnit(field.to)
+        || unitInfo(field.from).mode != unitInfo(field.to).mode) {
+        std::fprintf(stderr, "convert-cli: no valid unit pair for path '%s'\n", qPrintable(field.path));
+        return false;
+    }
+    return true;
+}
+
+static int runJson(const QString& path, const QStringList& specs, UnitId from, UnitId to,
+                   const NumberFormat& format)
+{
+    std::vector<JsonField> fields;
+    for (const QString& spec : specs) {
+        JsonField f;
+        if (!parseJsonSpec(spec, from, to, f)) return 2;
+        fields.push_back(f);
+    }
+    if (format.groupSeparator) {
+        std::fprintf(stderr, "convert-cli: --group would make the JSON invalid\n");
+        return 2;
+    }
+
+    std::FILE* in = openInput(path);
+    if (!in) return 1;
+
+    std::uint64_t converted = 0;
+    std::uint64_t skipped = 0;
+    QString error;
+    bool ok = convertJsonStream(in, stdout, fields, converted, skipped, error, format);
+    if (in != stdin) std::fclose(in);
+    if (ok && std::fflush(stdout) != 0) {
+        ok = false;
+        error = "write failed";
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "convert-cli: %s\n", qPrintable(error));
+        return 1;
+    }
+    if (skipped)
+        std::fprintf(stderr, "convert-cli: %llu selected values were not numbers and were left unchanged\n",
+                     static_cast<unsigned long long>(skipped));
+    return 0;
+}
+
+// Output number style from --fixed / --significant / --group; false on bad values.
+static bool numberFormatFromOptions(const QCommandLineParser& parser, const QCommandLineOption& fixedOpt,
+                                    const QCommandLineOption& sigOpt, const QCommandLineOption& groupOpt,
+                                    NumberFormat& format)
+{
+    if (parser.isSet(fixedOpt) && parser.isSet(sigOpt)) {
+        std::fprintf(stderr, "convert-cli: --fixed and --significant are exclusive\n");
+        return false;
+    }
+    bool ok = true;
+    if (parser.isSet(fixedOpt)) {
+        format.style = NumberFormat::Style::Fixed;
+        format.precision = parser.value(fixedOpt).toInt(&ok);
+    } else if (parser.isSet(sigOpt)) {
+        format.style = NumberFormat::Style::Significant;
+        format.precision = parser.value(sigOpt).toInt(&ok);
+    }
+    if (!ok) {
+        std::fprintf(stderr, "convert-cli: precision must be a number\n");
+        return false;
+    }
+    if (parser.isSet(groupOpt)) {
+        const QString sep = parser.value(groupOpt);
+        // ',' and '\n' separate values, '.', 'e' and digits are part of them
+        if (sep.size() != 1 || sep.at(0).unicode() > 0x7f || QString(",\n.-+eE0123456789").contains(sep)) {
+            std::fprintf(stderr, "convert-cli: --group takes one ASCII character that is not a digit, sign, '.', 'e' or ','\n");
+            return false;
+        }
+        format.groupSeparator = sep.at(0).toLatin1();
+    }
+    return true;
+}
+
+static int runBinary(const QString& path, const QString& outPath, const QString& typeName,
+                     int threads, UnitId from, UnitId to)
+{
+    ColumnType type;
+    if (typeName == "f64") type = ColumnType::Float64;
+    else if (typeName == "f32") type = ColumnType::Float32;
+    else {
+        std::fprintf(stderr, "convert-cli: --binary takes f64 or f32\n");
+        return 2;
+    }
+    if (path.isEmpty()) {
+        std::fprintf(stderr, "convert-cli: --binary needs an input file\n");
+        return 2;
+    }
+
+    QString error;
+    if (!convertColumnFile(path, outPath, type, from, to, threads, error)) {
+        std::fprintf(stderr, "convert-cli: %s\n", qPrintable(error));
+        return 1;
+    }
+    return 0;
+}
+
+static void listUnits()
+{
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        const UnitMode mode = static_cast<UnitMode>(m);
+        const std::string_view modeName = unitModeName(mode);
+        std::printf("%s%.*s:\n", m ? "\n" : "", int(modeName.size()), modeName.data());
+        const UnitRange r = unitRange(mode);
+        for (std::size_t i = r.first; i < r.first + r.count; ++i)
+            std::printf("  %-8.*s %.*s\n", int(kUnits[i].key.size()), kUnits[i].key.data(),
+                        int(kUnits[i].name.size()), kUnits[i].name.data());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("convert-cli");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Converts newline- or comma-separated numbers between units.\n"
+                                     "With --binary, converts a raw little-endian column file through\n"
+                                     "memory mappings, in place unless --output is given.\n"
+                                     "With --column, converts the named columns of a CSV file\n"
+                                     "and copies everything else through.\n"
+                                     "With --json, converts the numbers at the given paths of a JSON\n"
+                                     "or NDJSON stream, e.g. $.readings[*].temp_f, in one streaming pass.\n"
+                                     "With --timestamps, converts timestamps between Unix counts and\n"
+                                     "ISO-8601 in any time zone, e.g. --from unix_ms --to iso@Europe/Paris.\n"
+                                     "Numbers are printed as the shortest text that reads back\n"
+                                     "to the same double unless --fixed or --significant is given.\n"
+                                     "Run with --list-units for the unit keys.");
+    parser.addHelpOption();
+
+    const QCommandLineOption fromOpt({"f", "from"}, "Unit of the input values.", "unit");
+    const QCommandLineOption toOpt({"t", "to"}, "Unit to convert to.", "unit");
+    const QCommandLineOption binaryOpt("binary", "Input is a raw column of f64 or f32 values.", "type");
+    const QCommandLineOption outputOpt({"o", "output"}, "Output file for --binary (default: in place).", "file");
+    const QCommandLineOption columnOpt({"c", "column"},
+                                       "CSV column to convert, as NAME or NAME:FROM:TO (repeatable).", "spec");
+    const QCommandLineOption jsonOpt("json",
+                                     "JSON path to convert, as PATH or PATH:FROM:TO (repeatable).", "spec");
+    const QCommandLineOption timestampsOpt("timestamps",
+                                           "Input fields are timestamps; --from and --to are unix, unix_ms, unix_us,\n"
+                                           "unix_ns or iso, iso optionally with @Zone (iso@America/New_York).\n"
+                                           "ISO-8601 input without an offset is local time in that zone.");
+    const QCommandLineOption fixedOpt("fixed", "Print n digits after the decimal point.", "n");
+    const QCommandLineOption sigOpt("significant", "Print n significant digits.", "n");
+    const QCommandLineOption exactOpt("exact", "Convert the numbers as the decimals they are written as and round\n"
+                                               "correctly (98.6, not 98.60000000000001); at most 15 digits.");
+    const QCommandLineOption groupOpt("group", "Group integer digits in threes with char (e.g. \"'\" or '_').", "char");
+    const QCommandLineOption threadsOpt({"j", "threads"}, "Worker threads (default: all cores).", "n", "0");
+    const QCommandLineOption listOpt("list-units", "List the unit keys of every mode and exit.");
+    parser.addOption(fromOpt);
+    parser.addOption(toOpt);
+    parser.addOption(binaryOpt);
+    parser.addOption(outputOpt);
+    parser.addOption(columnOpt);
+    parser.addOption(jsonOpt);
+    parser.addOption(timestampsOpt);
+    parser.addOption(fixedOpt);
+    parser.addOption(sigOpt);
+    parser.addOption(exactOpt);
+    parser.addOption(groupOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(listOpt);
+    parser.addPositionalArgument("file", "Input file (default: stdin).", "[file]");
+    parser.process(app);
+
+    if (parser.isSet(listOpt)) {
+        listUnits();
+        return 0;
+    }
+
+    const QStringList args = parser.positionalArguments();
+    const QString path = args.isEmpty() ? QString() : args.first();
+    const int threads = parser.value(threadsOpt).toInt();
+
+    // timestamp formats are not units
+    if (parser.isSet(timestampsOpt)) {
+        if (!parser.isSet(fromOpt) || !parser.isSet(toOpt)) {
+            std::fprintf(stderr, "convert-cli: --from and --to are required\n");
+            return 2;
+        }
+        return runTimestamps(path, parser.value(fromOpt), parser.value(toOpt));
+    }
+
+    NumberFormat format;
+    if (!numberFormatFromOptions(parser, fixedOpt, sigOpt, groupOpt, format)) return 2;
+
+    // CSV columns and JSON paths may carry their own units, so --from/--to are optional there
+    UnitId from = UnitId::Invalid;
+    UnitId to = UnitId::Invalid;
+    if (parser.isSet(fromOpt)) {
+        from = unitFromOption(parser, fromOpt);
+        if (!isValidUnit(from)) return 2;
+    }
+    if (parser.isSet(toOpt)) {
+        to = unitFromOption(parser, toOpt);
+        if (!isValidUnit(to)) return 2;
+    }
+
+    if (parser.isSet(exactOpt) && (parser.isSet(columnOpt) || parser.isSet(jsonOpt) || parser.isSet(binaryOpt))) {
+        std::fprintf(stderr, "convert-cli: --exact applies to plain number streams only\n");
+        return 2;
+    }
+
+    if (parser.isSet(columnOpt))
+        return runCsv(path, parser.values(columnOpt), threads, from, to, format);
+    if (parser.isSet(jsonOpt))
+        return runJson(path, parser.values(jsonOpt), from, to, format);
+
+    if (!isValidUnit(from) || !isValidUnit(to)) {
+        std::fprintf(stderr, "convert-cli: --from and --to are required\n");
+        return 2;
+    }
+    if (unitInfo(from).mode != unitInfo(to).mode) {
+        std::fprintf(stderr, "convert-cli: cannot convert %s to %s\n",
+                     qPrintable(parser.value(fromOpt)), qPrintable(parser.value(toOpt)));
+        return 2;
+    }
+
+    if (parser.isSet(binaryOpt))
+        return runBinary(path, parser.value(outputOpt), parser.value(binaryOpt), threads, from, to);
+    return runText(path, from, to, format, parser.isSet(exactOpt));
+}
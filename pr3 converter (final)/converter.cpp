@@ -1,78 +1,201 @@
 #include "converter.h"
-#include <stdexcept>
+#include "derivedunit.h"
+#include "unitexpr.h"
+#include "batchkernels.h"
+#include <algorithm>
+#include <cassert>
+#include <limits>
 
-double Converter::convert(Mode mode, double value, const QString& fromUnit, const QString& toUnit)
+namespace {
+
+// One N x N table per mode, stored back to back; tableOffset is where a mode's table starts.
+struct ModeTable {
+    std::size_t first;
+    std::size_t count;
+    std::size_t tableOffset;
+};
+
+// kModeTables, kAffineTable: folded by unitgen at build time (see affine.h for the folding).
+#include "unitcatalog_affine.inc"
+
+static_assert(sizeof(kModeTables) / sizeof(kModeTables[0]) == kModeCount, "kModeTables must list every mode");
+static_assert(sizeof(Affine) == 2 * sizeof(double), "fanOut reads table rows as (scale, offset) pairs");
+
+// UTF-16 -> UTF-8 into a caller buffer; false if it does not fit. Unit names are hashed as
+// UTF-8, and encoding on the stack keeps lookups free of QByteArray allocations.
+bool toUtf8(QStringView text, char* out, std::size_t capacity, std::size_t& length)
 {
-    if (fromUnit == toUnit) return value;
+    length = 0;
+    for (qsizetype i = 0; i < text.size(); ++i) {
+        char32_t c = text[i].unicode();
+        if (QChar::isHighSurrogate(c) && i + 1 < text.size() && text[i + 1].isLowSurrogate())
+            c = QChar::surrogateToUcs4(static_cast<char16_t>(c), text[++i].unicode());
 
-    switch (mode) {
-    case Mode::Length: {
-        const double m = lengthToMeters(value, fromUnit);
-        return metersToLength(m, toUnit);
-    }
-    case Mode::Mass: {
-        const double kg = massToKg(value, fromUnit);
-        return kgToMass(kg, toUnit);
+        const std::size_t n = c < 0x80 ? 1 : c < 0x800 ? 2 : c < 0x10000 ? 3 : 4;
+        if (length + n > capacity) return false;
+        char* p = out + length;
+        switch (n) {
+        case 1: p[0] = static_cast<char>(c); break;
+        case 2: p[0] = static_cast<char>(0xC0 | (c >> 6)); break;
+        case 3: p[0] = static_cast<char>(0xE0 | (c >> 12)); break;
+        default: p[0] = static_cast<char>(0xF0 | (c >> 18)); break;
+        }
+        for (std::size_t k = 1; k < n; ++k)
+            p[k] = static_cast<char>(0x80 | ((c >> (6 * (n - 1 - k))) & 0x3F));
+        length += n;
     }
-    case Mode::Temperature: {
-        const double k = tempToKelvin(value, fromUnit);
-        return kelvinToTemp(k, toUnit);
-    }
-    }
-    return value;
+    return true;
+}
+
+} // namespace
+
+ConvError Converter::convert(Mode mode, double value, const QString& fromUnit, const QString& toUnit,
+                             double& out) noexcept
+{
+    const UnitId from = unitId(fromUnit);
+    const UnitId to = unitId(toUnit);
+    if (const ConvError e = checkUnits(mode, from, to); e != ConvError::None) return e;
+
+    out = convert(from, to, value);
+    return ConvError::None;
+}
+
+ConvError Converter::tryConvert(UnitId from, UnitId to, double value, double& out) noexcept
+{
+    if (!isValidUnit(from) || !isValidUnit(to)) return ConvError::UnknownUnit;
+    if (unitInfo(from).mode != unitInfo(to).mode) return ConvError::ModeMismatch;
+
+    out = convert(from, to, value);
+    return ConvError::None;
 }
 
-// ----- Length: base meter -----
-double Converter::lengthToMeters(double v, const QString& u)
+ConvError Converter::checkUnits(Mode mode, UnitId from, UnitId to) noexcept
 {
-    if (u == "m")  return v;
-    if (u == "km") return v * 1000.0;
-    if (u == "in") return v * 0.0254;
-    if (u == "ft") return v * 0.3048;
-    if (u == "mi") return v * 1609.344;
-    throw std::invalid_argument("Unknown length unit");
+    if (!isValidUnit(from) || !isValidUnit(to)) return ConvError::UnknownUnit;
+    if (unitInfo(from).mode != mode || unitInfo(to).mode != mode) return ConvError::ModeMismatch;
+    return ConvError::None;
 }
 
-double Converter::metersToLength(double meters, const QString& u)
+ConvError Converter::convertBatch(Mode mode, UnitId from, UnitId to,
+                                  std::span<const double> in, std::span<double> out) noexcept
 {
-    if (u == "m")  return meters;
-    if (u == "km") return meters / 1000.0;
-    if (u == "in") return meters / 0.0254;
-    if (u == "ft") return meters / 0.3048;
-    if (u == "mi") return meters / 1609.344;
-    throw std::invalid_argument("Unknown length unit");
+    if (const ConvError e = checkUnits(mode, from, to); e != ConvError::None) return e;
+    if (out.size() < in.size()) return ConvError::OutputTooSmall;
+
+    const Affine a = coefficients(from, to);
+    affineBatch(in.data(), out.data(), in.size(), a.scale, a.offset);
+    return ConvError::None;
 }
 
-// ----- Mass: base kilogram -----
-double Converter::massToKg(double v, const QString& u)
+ConvError Converter::convertBatch(Mode mode, UnitId from, UnitId to,
+                                  std::span<const float> in, std::span<float> out) noexcept
 {
-    if (u == "kg") return v;
-    if (u == "lb") return v * 0.45359237;
-    if (u == "oz") return v * 0.028349523125;
-    throw std::invalid_argument("Unknown mass unit");
+    if (const ConvError e = checkUnits(mode, from, to); e != ConvError::None) return e;
+    if (out.size() < in.size()) return ConvError::OutputTooSmall;
+
+    const Affine a = coefficients(from, to);
+    affineBatch(in.data(), out.data(), in.size(), a.scale, a.offset);
+    return ConvError::None;
 }
 
-double Converter::kgToMass(double kg, const QString& u)
+ConvError Converter::convertBatch(const DerivedUnit& from, const DerivedUnit& to,
+                                  std::span<const double> in, std::span<double> out) noexcept
 {
-    if (u == "kg") return kg;
-    if (u == "lb") return kg / 0.45359237;
-    if (u == "oz") return kg / 0.028349523125;
-    throw std::invalid_argument("Unknown mass unit");
+    double factor = 0.0;
+    if (derivedFactor(from, to, factor) != DerivedUnitError::None) return ConvError::ModeMismatch;
+    if (out.size() < in.size()) return ConvError::OutputTooSmall;
+
+    affineBatch(in.data(), out.data(), in.size(), factor, 0.0);
+    return ConvError::None;
 }
 
-// ----- Temperature: base Kelvin -----
-double Converter::tempToKelvin(double v, const QString& u)
+std::ptrdiff_t Converter::convertBatch(std::span<const UnitId> from, std::span<const UnitId> to,
+                                       std::span<const double> in, std::span<double> out,
+                                       std::span<std::uint64_t> errorBits) noexcept
 {
-    if (u == "K") return v;
-    if (u == "C") return v + 273.15;
-    if (u == "F") return (v - 32.0) * 5.0/9.0 + 273.15;
-    throw std::invalid_argument("Unknown temperature unit");
+    const std::size_t n = in.size();
+    if (from.size() < n || to.size() < n || out.size() < n || errorBits.size() * 64 < n)
+        return -1;
+
+    std::ptrdiff_t failed = 0;
+    for (std::size_t w = 0; w * 64 < n; ++w) {
+        std::uint64_t bits = 0;
+        const std::size_t end = std::min(n, w * 64 + 64);
+        for (std::size_t i = w * 64; i < end; ++i) {
+            const bool ok = isValidUnit(from[i]) && isValidUnit(to[i])
+                            && unitInfo(from[i]).mode == unitInfo(to[i]).mode;
+            if (ok) {
+                out[i] = convert(from[i], to[i], in[i]);
+            } else {
+                out[i] = std::numeric_limits<double>::quiet_NaN();
+                bits |= std::uint64_t(1) << (i - w * 64);
+                ++failed;
+            }
+        }
+        errorBits[w] = bits;
+    }
+    return failed;
+}
+
+ConvError Converter::fanOut(UnitId from, double value, std::span<double> out) noexcept
+{
+    if (!isValidUnit(from)) return ConvError::UnknownUnit;
+    const ModeTable& mt = kModeTables[static_cast<std::size_t>(unitInfo(from).mode)];
+    if (out.size() < mt.count) return ConvError::OutputTooSmall;
+
+    const Affine* row = kAffineTable + mt.tableOffset + (static_cast<std::size_t>(from) - mt.first) * mt.count;
+    affineFanOut(value, &row->scale, out.data(), mt.count);
+    return ConvError::None;
+}
+
+ConvError Converter::evaluateBatch(const UnitExpression& expr, UnitId to,
+                                   std::span<const double> in, std::span<double> out) noexcept
+{
+    if (!isValidUnit(to)) return ConvError::UnknownUnit;
+    if (expr.hasDimension() && expr.mode() != unitInfo(to).mode) return ConvError::ModeMismatch;
+    if (out.size() < in.size()) return ConvError::OutputTooSmall;
+
+    // Compose with the conversion so affine expressions still take a single batch pass.
+    // A lone unit goes to `to` directly rather than through the base unit, which would
+    // round twice ("x F" in C must give exactly 0 for 32).
+    Affine pre = expr.affine();
+    Affine post;
+    if (isValidUnit(expr.unit())) {
+        pre = expr.unitAffine();
+        post = coefficients(expr.unit(), to);
+    } else if (expr.hasDimension()) {
+        post = coefficients(baseUnit(expr.mode()), to);
+    }
+
+    if (expr.isAffine()) {
+        affineBatch(in.data(), out.data(), in.size(), pre.scale * post.scale, post.apply(pre.offset));
+        return ConvError::None;
+    }
+    expr.evaluate(in, out);
+    affineBatch(out.data(), out.data(), in.size(), post.scale, post.offset);
+    return ConvError::None;
+}
+
+double Converter::convert(UnitId from, UnitId to, double value) noexcept
+{
+    return coefficients(from, to).apply(value);
+}
+
+Converter::Affine Converter::coefficients(UnitId from, UnitId to) noexcept
+{
+    assert(isValidUnit(from) && isValidUnit(to));
+    assert(unitInfo(from).mode == unitInfo(to).mode);
+
+    const ModeTable& mt = kModeTables[static_cast<std::size_t>(unitInfo(from).mode)];
+    const std::size_t i = static_cast<std::size_t>(from) - mt.first;
+    const std::size_t j = static_cast<std::size_t>(to) - mt.first;
+    return kAffineTable[mt.tableOffset + i * mt.count + j];
 }
 
-double Converter::kelvinToTemp(double k, const QString& u)
+UnitId Converter::unitId(const QString& key) noexcept
 {
-    if (u == "K") return k;
-    if (u == "C") return k - 273.15;
-    if (u == "F") return (k - 273.15) * 9.0/5.0 + 32.0;
-    throw std::invalid_argument("Unknown temperature unit");
+    char utf8[kUnitNameMaxBytes];
+    std::size_t length = 0;
+    if (!toUtf8(key, utf8, sizeof(utf8), length)) return UnitId::Invalid;
+    return unitIdFromKey(std::string_view(utf8, length));
 }
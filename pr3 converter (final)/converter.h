@@ -1,24 +1,75 @@
 #pragma once
 #include <QString>
+#include <span>
+#include "affine.h"
+#include "unitregistry.h"
 
+class DerivedUnit;
+class UnitExpression;
+
+enum class ConvError : std::uint8_t {
+    None,
+    UnknownUnit,   // a key or UnitId is not in the registry
+    ModeMismatch,  // the units belong to different modes (or not to the requested one)
+    OutputTooSmall
+};
+
+// Nothing in Converter throws; failures are reported as ConvError.
 class Converter
 {
 public:
-    enum class Mode { Length, Mass, Temperature };
+    using Mode = UnitMode;
+
+    using Affine = ::Affine;
+
+    // Units are catalogue keys or aliases ("m", "ft", "feet", "°C", ...; see units.catalog).
+    // out is only written on success.
+    static ConvError convert(Mode mode, double value, const QString& fromUnit, const QString& toUnit,
+                             double& out) noexcept;
+
+    // Checked UnitId conversion; out is only written on success.
+    static ConvError tryConvert(UnitId from, UnitId to, double value, double& out) noexcept;
+
+    // Hot path: no string work, no checks. Both units must be valid and belong to the same mode.
+    static double convert(UnitId from, UnitId to, double value) noexcept;
+
+    // Fused from->to coefficients, for callers that hoist the lookup out of a loop.
+    // Same preconditions as convert(UnitId, UnitId, double).
+    static Affine coefficients(UnitId from, UnitId to) noexcept;
+
+    // Same mode check as the checked overloads, without converting anything.
+    static ConvError checkUnits(Mode mode, UnitId from, UnitId to) noexcept;
+
+    // Vectorized convert over in.size() values (SIMD kernel picked at runtime, see batchkernels.h).
+    // Nothing is written unless both units belong to mode and out is at least as long as in.
+    static ConvError convertBatch(Mode mode, UnitId from, UnitId to,
+                                  std::span<const double> in, std::span<double> out) noexcept;
+    static ConvError convertBatch(Mode mode, UnitId from, UnitId to,
+                                  std::span<const float> in, std::span<float> out) noexcept;
+
+    // Compound units (derivedunit.h): in scaled by the cached from->to factor. ModeMismatch
+    // if their dimensions differ. Affine units such as C and F count as differences there.
+    static ConvError convertBatch(const DerivedUnit& from, const DerivedUnit& to,
+                                  std::span<const double> in, std::span<double> out) noexcept;
 
-    // unit keys are the short ones: "m", "km", "in", "ft", "mi", "kg", "lb", "oz", "C", "F", "K"
-    static double convert(Mode mode, double value, const QString& fromUnit, const QString& toUnit);
+    // Per-element units: element i converts in[i] from from[i] to to[i]. Failed elements get NaN
+    // and their bit set in errorBits (bit i % 64 of word i / 64; all other bits are cleared).
+    // Returns the number of failed elements, or -1 if a span is too short for in.size() elements.
+    static std::ptrdiff_t convertBatch(std::span<const UnitId> from, std::span<const UnitId> to,
+                                       std::span<const double> in, std::span<double> out,
+                                       std::span<std::uint64_t> errorBits) noexcept;
 
-private:
-    // Length (base: meter)
-    static double lengthToMeters(double v, const QString& u);
-    static double metersToLength(double meters, const QString& u);
+    // value in `from`, converted to every unit of from's mode in one vectorized pass over the
+    // fused table row: out[unitIndexInMode(u)] receives the value in u. Nothing is written
+    // unless from is valid and out holds unitRange(mode).count values.
+    static ConvError fanOut(UnitId from, double value, std::span<double> out) noexcept;
 
-    // Mass (base: kilogram)
-    static double massToKg(double v, const QString& u);
-    static double kgToMass(double kg, const QString& u);
+    // Evaluates a compiled expression (see unitexpr.h) for every x in in, with the result
+    // converted to `to`; a dimensionless expression is taken to be in `to` already.
+    // Nothing is written unless the expression's mode matches to's and out is long enough.
+    static ConvError evaluateBatch(const UnitExpression& expr, UnitId to,
+                                   std::span<const double> in, std::span<double> out) noexcept;
 
-    // Temperature (base: Kelvin)
-    static double tempToKelvin(double v, const QString& u);
-    static double kelvinToTemp(double k, const QString& u);
+    // Perfect-hash lookup of a key or alias; returns UnitId::Invalid for unknown names.
+    static UnitId unitId(const QString& key) noexcept;
 };
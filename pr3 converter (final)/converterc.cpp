@@ -0,0 +1,130 @@
+#include "converterc.h"
+#include "converter.h"
+#include "derivedunit.h"
+#include "unitindex.h"
+
+#include <cstring>
+#include <string_view>
+
+// Keys, names and mode names come from string literals in the generated catalogue, so the
+// views handed out below are NUL-terminated.
+
+namespace {
+
+bool validHandle(cvt_unit unit)
+{
+    return unit >= 0 && isValidUnit(static_cast<UnitId>(unit));
+}
+
+cvt_unit toHandle(UnitId id)
+{
+    return isValidUnit(id) ? cvt_unit(id) : CVT_INVALID_UNIT;
+}
+
+cvt_status toStatus(ConvError e)
+{
+    switch (e) {
+    case ConvError::None: return CVT_OK;
+    case ConvError::UnknownUnit: return CVT_UNKNOWN_UNIT;
+    case ConvError::ModeMismatch: return CVT_MODE_MISMATCH;
+    case ConvError::OutputTooSmall: break;
+    }
+    return CVT_INVALID_ARGUMENT;
+}
+
+template <typename T>
+cvt_status convertBatch(cvt_unit from, cvt_unit to, const T* in, T* out, size_t count)
+{
+    if (!validHandle(from) || !validHandle(to)) return CVT_UNKNOWN_UNIT;
+    if (count != 0 && (!in || !out)) return CVT_INVALID_ARGUMENT;
+    if (count == 0) in = out = nullptr;
+    const UnitId f = static_cast<UnitId>(from);
+    return toStatus(Converter::convertBatch(unitInfo(f).mode, f, static_cast<UnitId>(to),
+                                            std::span<const T>(in, count), std::span<T>(out, count)));
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t cvt_abi_version(void)
+{
+    return CVT_ABI_VERSION;
+}
+
+int32_t cvt_unit_count(void)
+{
+    return int32_t(kUnitCount);
+}
+
+cvt_unit cvt_unit_from_key(const char* name, size_t length)
+{
+    return name ? toHandle(unitIdFromKey(std::string_view(name, length))) : CVT_INVALID_UNIT;
+}
+
+cvt_unit cvt_unit_match(const char* name, size_t length)
+{
+    return name ? toHandle(bestUnitMatch(std::string_view(name, length))) : CVT_INVALID_UNIT;
+}
+
+const char* cvt_unit_key(cvt_unit unit)
+{
+    return validHandle(unit) ? unitInfo(static_cast<UnitId>(unit)).key.data() : nullptr;
+}
+
+const char* cvt_unit_name(cvt_unit unit)
+{
+    return validHandle(unit) ? unitInfo(static_cast<UnitId>(unit)).name.data() : nullptr;
+}
+
+const char* cvt_unit_mode(cvt_unit unit)
+{
+    return validHandle(unit) ? unitModeName(unitInfo(static_cast<UnitId>(unit)).mode).data() : nullptr;
+}
+
+cvt_status cvt_convert(cvt_unit from, cvt_unit to, double value, double* out)
+{
+    if (!out) return CVT_INVALID_ARGUMENT;
+    if (!validHandle(from) || !validHandle(to)) return CVT_UNKNOWN_UNIT;
+    return toStatus(Converter::tryConvert(static_cast<UnitId>(from), static_cast<UnitId>(to), value, *out));
+}
+
+cvt_status cvt_convert_batch(cvt_unit from, cvt_unit to, const double* in, double* out, size_t count)
+{
+    return convertBatch(from, to, in, out, count);
+}
+
+cvt_status cvt_convert_batch_f32(cvt_unit from, cvt_unit to, const float* in, float* out, size_t count)
+{
+    return convertBatch(from, to, in, out, count);
+}
+
+cvt_status cvt_convert_units_batch(const char* from, const char* to, const double* in, double* out, size_t count)
+{
+    if (!from || !to) return CVT_INVALID_ARGUMENT;
+    const std::string_view fromText(from, std::strlen(from));
+    const std::string_view toText(to, std::strlen(to));
+
+    DerivedUnit fromUnit;
+    DerivedUnit toUnit;
+    if (DerivedUnit::parse(fromText, fromUnit) != DerivedUnitError::None
+        || DerivedUnit::parse(toText, toUnit) != DerivedUnitError::None)
+        return CVT_UNKNOWN_UNIT;
+
+    // two single units, however spelled ("C", "Celsius"), keep their offsets (100 C is 212 F),
+    // which a compound would drop; only real compounds go through derivedFactor
+    const auto single = [](const DerivedUnit& u) {
+        return u.terms().size() == 1 && u.terms()[0].exponent == 1 ? u.terms()[0].unit : UnitId::Invalid;
+    };
+    const UnitId f = single(fromUnit);
+    const UnitId t = single(toUnit);
+    if (isValidUnit(f) && isValidUnit(t) && unitInfo(f).mode == unitInfo(t).mode)
+        return convertBatch(cvt_unit(f), cvt_unit(t), in, out, count);
+
+    if (count != 0 && (!in || !out)) return CVT_INVALID_ARGUMENT;
+    if (count == 0) in = out = nullptr;
+    return toStatus(Converter::convertBatch(fromUnit, toUnit, std::span<const double>(in, count),
+                                            std::span<double>(out, count)));
+}
+
+} // extern "C"
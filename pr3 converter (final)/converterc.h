@@ -0,0 +1,92 @@
+/*
+ * C interface to the conversion core, for in-process use from other languages
+ * (ctypes/cffi, cgo, ...). Built as the converterc shared library.
+ *
+ * Only this header's types cross the boundary: fixed-width integers, doubles, floats and
+ * NUL-terminated UTF-8. Nothing allocates on the caller's behalf, nothing throws, and every
+ * function is thread-safe. The ABI only grows: functions are never removed or changed, and
+ * cvt_abi_version() goes up when new ones are added.
+ *
+ * Unit handles index the library's built-in catalogue. They are stable for one build of
+ * the library, not across versions, so look units up by key at startup rather than
+ * hard-coding numbers.
+ */
+#ifndef CONVERTERC_H
+#define CONVERTERC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(CONVERTERC_BUILD)
+#    define CVT_API __declspec(dllexport)
+#  else
+#    define CVT_API __declspec(dllimport)
+#  endif
+#else
+#  define CVT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CVT_ABI_VERSION 1
+
+typedef int32_t cvt_unit;   /* catalogue unit, or CVT_INVALID_UNIT */
+typedef int32_t cvt_status;
+
+#define CVT_INVALID_UNIT ((cvt_unit)-1)
+
+#define CVT_OK               0
+#define CVT_UNKNOWN_UNIT     1 /* a handle or name is not in the catalogue */
+#define CVT_MODE_MISMATCH    2 /* the units measure different things (m to kg) */
+#define CVT_INVALID_ARGUMENT 3 /* a null pointer where values are required */
+
+/* CVT_ABI_VERSION of the loaded library; callers built against a newer header check this. */
+CVT_API uint32_t cvt_abi_version(void);
+
+/* Catalogue units are 0 .. cvt_unit_count() - 1. */
+CVT_API int32_t cvt_unit_count(void);
+
+/* Key or alias ("m", "ft", "degF"), exact and case-sensitive; CVT_INVALID_UNIT if none.
+ * name is UTF-8 of length bytes and need not be NUL-terminated. */
+CVT_API cvt_unit cvt_unit_from_key(const char* name, size_t length);
+
+/* Forgiving lookup ("Feet", "kilometres", "farenheit"): the best match, or CVT_INVALID_UNIT. */
+CVT_API cvt_unit cvt_unit_match(const char* name, size_t length);
+
+/* The unit's key ("ft") and display name ("feet"), NUL-terminated and valid for the life of
+ * the process; NULL for an invalid handle. */
+CVT_API const char* cvt_unit_key(cvt_unit unit);
+CVT_API const char* cvt_unit_name(cvt_unit unit);
+
+/* What the unit measures ("Length", "Temperature"); NULL for an invalid handle. Two units
+ * convert when their modes are equal. */
+CVT_API const char* cvt_unit_mode(cvt_unit unit);
+
+/* *out = value converted from one unit to the other; *out is untouched on failure. */
+CVT_API cvt_status cvt_convert(cvt_unit from, cvt_unit to, double value, double* out);
+
+/* out[i] = in[i] converted, for i < count, by the SIMD kernel best suited to this CPU.
+ * in and out may be the same array but must not otherwise overlap. count may be 0 (the
+ * pointers are then ignored). Nothing is written on failure. */
+CVT_API cvt_status cvt_convert_batch(cvt_unit from, cvt_unit to, const double* in, double* out,
+                                     size_t count);
+CVT_API cvt_status cvt_convert_batch_f32(cvt_unit from, cvt_unit to, const float* in, float* out,
+                                         size_t count);
+
+/* As cvt_convert_batch, between units given as text: catalogue names or compound units such
+ * as "mi/gal", "kg*m/s^2" or "J/(kg K)", which convert when their dimensions agree (CVT_MODE_MISMATCH
+ * otherwise). Units with an offset count as temperature differences inside a compound.
+ * Names are NUL-terminated UTF-8. Two plain catalogue units of one mode, however they are
+ * spelled ("C", "Celsius"), convert exactly as in cvt_convert_batch, offsets included; the
+ * factor between compounds is cached per pair. */
+CVT_API cvt_status cvt_convert_units_batch(const char* from, const char* to, const double* in, double* out,
+                                           size_t count);
+
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
+
+#endif /* CONVERTERC_H */
@@ -0,0 +1,203 @@
+#include "converter.h"
+#include "serviceprotocol.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+constexpr int kTimeoutMs = 30000;
+
+struct LoadOptions {
+    std::uint32_t requests = 10000;
+    std::uint32_t warmup = 100;
+    std::uint32_t pipeline = 16;
+    std::uint32_t values = 4096;
+    QByteArray from = "ft";
+    QByteArray to = "m";
+};
+
+double percentile(std::vector<qint64>& sorted, double p)
+{
+    if (sorted.empty()) return 0.0;
+    const std::size_t i = std::min(sorted.size() - 1, std::size_t(p * double(sorted.size())));
+    return double(sorted[i]);
+}
+
+// Keeps up to `pipeline` requests in flight on one connection and times each from the
+// moment it is queued to the moment its response has been parsed.
+int run(QIODevice& socket, const LoadOptions& o)
+{
+    const UnitId from = unitIdFromKey(std::string_view(o.from.constData(), std::size_t(o.from.size())));
+    const UnitId to = unitIdFromKey(std::string_view(o.to.constData(), std::size_t(o.to.size())));
+
+    std::vector<double> values(o.values);
+    for (std::size_t i = 0; i < values.size(); ++i) values[i] = double(i % 1000) * 0.25;
+
+    // one encoded request; only the id field changes between sends
+    QByteArray frame;
+    appendServiceRequest(frame, 0, std::string_view(o.from.constData(), std::size_t(o.from.size())),
+                         std::string_view(o.to.constData(), std::size_t(o.to.size())), values);
+
+    const std::uint32_t total = o.warmup + o.requests;
+    std::vector<qint64> sentAt(total);
+    std::vector<qint64> latencies;
+    latencies.reserve(o.requests);
+    std::vector<double> results(o.values);
+    std::uint32_t sent = 0;
+    std::uint32_t received = 0;
+    std::uint32_t failures = 0;
+    qint64 measuredFrom = 0;
+    QByteArray in;
+
+    QElapsedTimer clock;
+    clock.start();
+    while (received < total) {
+        while (sent < total && sent - received < o.pipeline) {
+            qToLittleEndian<quint32>(sent, frame.data() + kServiceLengthBytes);
+            sentAt[sent] = clock.nsecsElapsed();
+            socket.write(frame);
+            ++sent;
+        }
+        while (socket.bytesToWrite() > 0) {
+            if (!socket.waitForBytesWritten(kTimeoutMs)) {
+                std::fprintf(stderr, "convert-loadgen: write failed: %s\n", qPrintable(socket.errorString()));
+                return 1;
+            }
+        }
+
+        if (socket.bytesAvailable() == 0 && !socket.waitForReadyRead(kTimeoutMs)) {
+            std::fprintf(stderr, "convert-loadgen: no response: %s\n", qPrintable(socket.errorString()));
+            return 1;
+        }
+        in.append(socket.readAll());
+
+        std::size_t used = 0;
+        for (;;) {
+            ServiceResponse response;
+            std::size_t frameBytes = 0;
+            const FrameState state = parseServiceResponse(in.constData() + used, std::size_t(in.size()) - used,
+                                                          response, frameBytes);
+            if (state == FrameState::Incomplete) break;
+            if (state == FrameState::Malformed || response.id != received) {
+                std::fprintf(stderr, "convert-loadgen: malformed or out-of-order response\n");
+                return 1;
+            }
+            const qint64 now = clock.nsecsElapsed();
+            if (received == o.warmup) measuredFrom = sentAt[received];
+            if (received >= o.warmup) latencies.push_back(now - sentAt[received]);
+
+            // spot-check the last value of each response against the local core
+            if (response.status != ServiceStatus::Ok || response.count != o.values) {
+                ++failures;
+            } else if (o.values > 0) {
+                readServiceValues(response, results);
+                if (results.back() != Converter::convert(from, to, values.back())) ++failures;
+            }
+            ++received;
+            used += frameBytes;
+        }
+        in.remove(0, qsizetype(used));
+    }
+    const double seconds = double(clock.nsecsElapsed() - measuredFrom) * 1e-9;
+
+    std::sort(latencies.begin(), latencies.end());
+    std::printf("requests        %u x %u values, pipeline %u\n", o.requests, o.values, o.pipeline);
+    std::printf("throughput      %.0f requests/s, %.0f values/s\n",
+                double(o.requests) / seconds, double(o.requests) * double(o.values) / seconds);
+    std::printf("latency (us)    p50 %.1f  p99 %.1f  max %.1f\n", percentile(latencies, 0.50) * 1e-3,
+                percentile(latencies, 0.99) * 1e-3, latencies.empty() ? 0.0 : double(latencies.back()) * 1e-3);
+    if (failures) {
+        std::fprintf(stderr, "convert-loadgen: %u response(s) failed or did not match\n", failures);
+        return 1;
+    }
+    return 0;
+}
+
+bool parseCount(const QCommandLineParser& parser, const QCommandLineOption& opt, std::uint32_t min, std::uint32_t& out)
+{
+    bool ok = false;
+    const uint v = parser.value(opt).toUInt(&ok);
+    if (!ok || v < min) {
+        std::fprintf(stderr, "convert-loadgen: bad --%s value\n", qPrintable(opt.names().constLast()));
+        return false;
+    }
+    out = v;
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("convert-loadgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Drives convert-service with pipelined batch requests and reports\n"
+                                     "throughput and p50/p99 request latency.");
+    parser.addHelpOption();
+
+    const QCommandLineOption nameOpt("name", "Local socket name (default convert-service).", "name", "convert-service");
+    const QCommandLineOption tcpOpt("tcp", "Connect to TCP 127.0.0.1:port instead.", "port");
+    const QCommandLineOption requestsOpt({"n", "requests"}, "Measured requests (default 10000).", "n", "10000");
+    const QCommandLineOption warmupOpt("warmup", "Unmeasured requests sent first (default 100).", "n", "100");
+    const QCommandLineOption pipelineOpt({"p", "pipeline"}, "Requests in flight (default 16).", "n", "16");
+    const QCommandLineOption valuesOpt("values", "Values per request (default 4096).", "n", "4096");
+    const QCommandLineOption fromOpt({"f", "from"}, "Unit to convert from (default ft).", "unit", "ft");
+    const QCommandLineOption toOpt({"t", "to"}, "Unit to convert to (default m).", "unit", "m");
+    parser.addOption(nameOpt);
+    parser.addOption(tcpOpt);
+    parser.addOption(requestsOpt);
+    parser.addOption(warmupOpt);
+    parser.addOption(pipelineOpt);
+    parser.addOption(valuesOpt);
+    parser.addOption(fromOpt);
+    parser.addOption(toOpt);
+    parser.process(app);
+
+    LoadOptions o;
+    if (!parseCount(parser, requestsOpt, 1, o.requests) || !parseCount(parser, warmupOpt, 0, o.warmup)
+        || !parseCount(parser, pipelineOpt, 1, o.pipeline) || !parseCount(parser, valuesOpt, 0, o.values))
+        return 2;
+    if (std::uint64_t(o.values) * sizeof(double) + 1024 > kMaxServiceFrameBytes) {
+        std::fprintf(stderr, "convert-loadgen: --values exceeds the protocol's frame limit\n");
+        return 2;
+    }
+    o.from = parser.value(fromOpt).toUtf8();
+    o.to = parser.value(toOpt).toUtf8();
+    const UnitId from = unitIdFromKey(std::string_view(o.from.constData(), std::size_t(o.from.size())));
+    const UnitId to = unitIdFromKey(std::string_view(o.to.constData(), std::size_t(o.to.size())));
+    if (!isValidUnit(from) || !isValidUnit(to) || unitInfo(from).mode != unitInfo(to).mode) {
+        std::fprintf(stderr, "convert-loadgen: cannot convert %s to %s\n", o.from.constData(), o.to.constData());
+        return 2;
+    }
+
+    if (parser.isSet(tcpOpt)) {
+        QTcpSocket socket;
+        socket.connectToHost(QHostAddress::LocalHost, parser.value(tcpOpt).toUShort());
+        if (!socket.waitForConnected(kTimeoutMs)) {
+            std::fprintf(stderr, "convert-loadgen: cannot connect: %s\n", qPrintable(socket.errorString()));
+            return 1;
+        }
+        socket.setSocketOption(QAbstractSocket::LowDelayOption, 1);
+        return run(socket, o);
+    }
+
+    QLocalSocket socket;
+    socket.connectToServer(parser.value(nameOpt));
+    if (!socket.waitForConnected(kTimeoutMs)) {
+        std::fprintf(stderr, "convert-loadgen: cannot connect: %s\n", qPrintable(socket.errorString()));
+        return 1;
+    }
+    return run(socket, o);
+}
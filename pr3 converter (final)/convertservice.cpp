@@ -0,0 +1,134 @@
+#include "serviceprotocol.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QHostAddress>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QtEndian>
+
+#include <cstdio>
+
+namespace {
+
+// A client that stops reading cannot make the service buffer without bound: past this
+// many unsent response bytes its requests wait in the socket until the backlog drains.
+constexpr qint64 kMaxPendingWriteBytes = 64 << 20;
+
+// One client connection. Every complete frame in the input is answered in order and the
+// responses go out in one write, so a pipelined burst costs one write per read.
+class ServiceConnection : public QObject
+{
+public:
+    explicit ServiceConnection(QIODevice* socket)
+        : QObject(socket)
+        , socket_(socket)
+    {
+        connect(socket_, &QIODevice::readyRead, this, &ServiceConnection::serve);
+        connect(socket_, &QIODevice::bytesWritten, this, [this]{
+            if (socket_->bytesAvailable() > 0 || !in_.isEmpty()) serve();
+        });
+    }
+
+private:
+    QIODevice* socket_;
+    QByteArray in_;
+    QByteArray out_;
+
+    void serve()
+    {
+        if (socket_->bytesToWrite() > kMaxPendingWriteBytes) return;
+        in_.append(socket_->readAll());
+
+        std::size_t used = 0;
+        const std::size_t size = std::size_t(in_.size());
+        bool malformed = false;
+        while (used < size) {
+            ServiceRequest request;
+            std::size_t frameBytes = 0;
+            const FrameState state = parseServiceRequest(in_.constData() + used, size - used, request, frameBytes);
+            if (state == FrameState::Incomplete) break;
+            if (state == FrameState::Malformed) {
+                malformed = true;
+                break;
+            }
+            appendServiceResponse(out_, request);
+            used += frameBytes;
+        }
+
+        if (malformed) {
+            // the id is still readable unless the frame is shorter than its header
+            const std::uint32_t id = size - used >= 8 ? qFromLittleEndian<quint32>(in_.constData() + used + 4) : 0;
+            appendServiceError(out_, id, ServiceStatus::BadRequest);
+        }
+        if (!out_.isEmpty()) {
+            socket_->write(out_);
+            out_.clear();
+        }
+        if (malformed) {
+            in_.clear();
+            socket_->close(); // after the queued responses are written
+            return;
+        }
+        in_.remove(0, qsizetype(used));
+    }
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("convert-service");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Serves unit conversions over a local socket (or TCP on localhost)\n"
+                                     "using the length-prefixed binary protocol in serviceprotocol.h.\n"
+                                     "Requests carry any number of values and may be pipelined.");
+    parser.addHelpOption();
+
+    const QCommandLineOption nameOpt("name", "Local socket name (default convert-service).", "name", "convert-service");
+    const QCommandLineOption tcpOpt("tcp", "Listen on TCP 127.0.0.1:port instead of a local socket.", "port");
+    parser.addOption(nameOpt);
+    parser.addOption(tcpOpt);
+    parser.process(app);
+
+    if (parser.isSet(tcpOpt)) {
+        bool ok = false;
+        const quint16 port = parser.value(tcpOpt).toUShort(&ok);
+        auto* server = new QTcpServer(&app);
+        if (!ok || !server->listen(QHostAddress::LocalHost, port)) {
+            std::fprintf(stderr, "convert-service: cannot listen on port %s: %s\n",
+                         qPrintable(parser.value(tcpOpt)), qPrintable(server->errorString()));
+            return 1;
+        }
+        QObject::connect(server, &QTcpServer::newConnection, server, [server]{
+            while (QTcpSocket* socket = server->nextPendingConnection()) {
+                socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+                QObject::connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+                new ServiceConnection(socket);
+            }
+        });
+        std::fprintf(stderr, "convert-service: listening on 127.0.0.1:%u\n", unsigned(server->serverPort()));
+    } else {
+        const QString name = parser.value(nameOpt);
+        auto* server = new QLocalServer(&app);
+        QLocalServer::removeServer(name); // stale socket file from a crashed instance
+        if (!server->listen(name)) {
+            std::fprintf(stderr, "convert-service: cannot listen on %s: %s\n",
+                         qPrintable(name), qPrintable(server->errorString()));
+            return 1;
+        }
+        QObject::connect(server, &QLocalServer::newConnection, server, [server]{
+            while (QLocalSocket* socket = server->nextPendingConnection()) {
+                QObject::connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+                new ServiceConnection(socket);
+            }
+        });
+        std::fprintf(stderr, "convert-service: listening on %s\n", qPrintable(server->fullServerName()));
+    }
+
+    return app.exec();
+}
@@ -0,0 +1,207 @@
+#include "converter.h"
+#include "filepipeline.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QTimer>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+std::atomic<int> failures{ 0 };
+
+void report(const FileResult& r)
+{
+    // one fprintf per line, so lines from the writer thread never interleave
+    if (!r.error.isEmpty()) {
+        ++failures;
+        std::fprintf(stderr, "convert-watch: %s: %s\n", qPrintable(r.input), qPrintable(r.error));
+    } else if (r.skipped) {
+        std::fprintf(stdout, "%s (%llu non-numeric fields left unchanged)\n", qPrintable(r.output),
+                     static_cast<unsigned long long>(r.skipped));
+    } else {
+        std::fprintf(stdout, "%s\n", qPrintable(r.output));
+    }
+    std::fflush(stdout);
+}
+
+// Watches one directory and hands each new or changed input file to the pipeline once it
+// has stopped changing. A file counts as complete when two scans settle ms apart see the
+// same size and modification time; producers that write under another name and rename
+// (data.csv.part -> data.csv) are picked up on the next scan.
+class FolderWatcher : public QObject
+{
+public:
+    FolderWatcher(const QString& dir, int settleMs, FilePipeline& pipeline, QObject* parent = nullptr)
+        : QObject(parent), dir_(dir), pipeline_(pipeline)
+    {
+        watcher_.addPath(dir_);
+        scanTimer_.setSingleShot(true);
+        scanTimer_.setInterval(settleMs);
+        // a burst of drops (thousands of files) costs one scan per settle interval
+        connect(&watcher_, &QFileSystemWatcher::directoryChanged, this, [this]{
+            if (!scanTimer_.isActive()) scanTimer_.start();
+        });
+        connect(&scanTimer_, &QTimer::timeout, this, &FolderWatcher::scan);
+        scan();
+    }
+
+    bool watching() const { return watcher_.directories().contains(dir_); }
+
+private:
+    struct Stamp {
+        qint64 size = -1;
+        qint64 modified = 0;
+        bool submitted = false;
+
+        bool sameFile(const Stamp& o) const { return size == o.size && modified == o.modified; }
+    };
+
+    QString dir_;
+    FilePipeline& pipeline_;
+    QFileSystemWatcher watcher_;
+    QTimer scanTimer_;
+    QHash<QString, Stamp> files_;
+
+    bool isConverted(const QFileInfo& input) const
+    {
+        const QFileInfo output(pipeline_.outputPath(input.absoluteFilePath()));
+        return output.exists() && output.lastModified() >= input.lastModified();
+    }
+
+    void scan()
+    {
+        QHash<QString, Stamp> now;
+        bool unsettled = false;
+        const QFileInfoList entries = QDir(dir_).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+        for (const QFileInfo& info : entries) {
+            const QString path = info.absoluteFilePath();
+            if (!pipeline_.accepts(path)) continue;
+
+            Stamp stamp{ info.size(), info.lastModified().toMSecsSinceEpoch() };
+            const auto it = files_.constFind(path);
+            if (it == files_.constEnd() && isConverted(info)) {
+                // converted before a restart
+                stamp.submitted = true;
+            } else if (it != files_.constEnd() && it->sameFile(stamp)) {
+                // unchanged for a settle interval: complete
+                stamp.submitted = true;
+                if (!it->submitted) pipeline_.submit(path);
+            } else {
+                unsettled = true;
+            }
+            now.insert(path, stamp);
+        }
+        files_.swap(now); // deleted files drop out here
+        if (unsettled && !scanTimer_.isActive()) scanTimer_.start();
+    }
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("convert-watch");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Watches a directory and converts every CSV (.csv) or raw little-endian\n"
+                                     "column (.f64, .f32) dropped into it, writing data.converted.csv etc.\n"
+                                     "next to the input. Output files appear atomically, complete or not at all.\n"
+                                     "Reading, converting and writing run on separate threads.");
+    parser.addHelpOption();
+
+    const QCommandLineOption fromOpt({"f", "from"}, "Unit of binary columns, and of --column specs without units.", "unit");
+    const QCommandLineOption toOpt({"t", "to"}, "Unit to convert to.", "unit");
+    const QCommandLineOption columnOpt({"c", "column"},
+                                       "CSV column to convert, as NAME or NAME:FROM:TO (repeatable).", "spec");
+    const QCommandLineOption tagOpt("tag", "Output name tag (default converted: a.csv -> a.converted.csv).",
+                                    "tag", "converted");
+    const QCommandLineOption settleOpt("settle", "Milliseconds a file must stay unchanged before it is converted.",
+                                       "ms", "500");
+    const QCommandLineOption queueOpt("queue", "Files held between two stages (default 16).", "n", "16");
+    const QCommandLineOption threadsOpt({"j", "threads"}, "Converter threads (default 1).", "n", "1");
+    const QCommandLineOption onceOpt("once", "Convert the files already there, then exit.");
+    parser.addOption(fromOpt);
+    parser.addOption(toOpt);
+    parser.addOption(columnOpt);
+    parser.addOption(tagOpt);
+    parser.addOption(settleOpt);
+    parser.addOption(queueOpt);
+    parser.addOption(threadsOpt);
+    parser.addOption(onceOpt);
+    parser.addPositionalArgument("dir", "Directory to watch.");
+    parser.process(app);
+
+    const QStringList args = parser.positionalArguments();
+    if (args.size() != 1 || !QFileInfo(args.first()).isDir()) {
+        std::fprintf(stderr, "convert-watch: one existing directory is required\n");
+        return 2;
+    }
+    const QString dir = QFileInfo(args.first()).absoluteFilePath();
+
+    FilePipelineConfig config;
+    config.from = Converter::unitId(parser.value(fromOpt));
+    config.to = Converter::unitId(parser.value(toOpt));
+    if (parser.isSet(fromOpt) != isValidUnit(config.from) || parser.isSet(toOpt) != isValidUnit(config.to)
+        || isValidUnit(config.from) != isValidUnit(config.to)
+        || (isValidUnit(config.from) && unitInfo(config.from).mode != unitInfo(config.to).mode)) {
+        std::fprintf(stderr, "convert-watch: --from and --to must name two units of one mode\n");
+        return 2;
+    }
+    for (const QString& spec : parser.values(columnOpt)) {
+        // NAME:FROM:TO, or NAME with the --from/--to pair
+        const QStringList parts = spec.split(':');
+        CsvColumn c{ parts.at(0), config.from, config.to };
+        if (parts.size() == 3) {
+            c.from = Converter::unitId(parts.at(1));
+            c.to = Converter::unitId(parts.at(2));
+        }
+        if (!isValidUnit(c.from) || !isValidUnit(c.to) || unitInfo(c.from).mode != unitInfo(c.to).mode) {
+            std::fprintf(stderr, "convert-watch: no valid unit pair for column '%s'\n", qPrintable(c.name));
+            return 2;
+        }
+        config.columns.push_back(c);
+    }
+    if (config.columns.empty() && !isValidUnit(config.from)) {
+        std::fprintf(stderr, "convert-watch: give --column for CSV files or --from/--to for binary columns\n");
+        return 2;
+    }
+    bool ok = true;
+    config.tag = parser.value(tagOpt);
+    config.queueDepth = std::size_t(std::max(parser.value(queueOpt).toInt(&ok), 1));
+    config.convertThreads = std::max(parser.value(threadsOpt).toInt(), 1);
+    const int settleMs = std::max(parser.value(settleOpt).toInt(), 0);
+    if (config.tag.isEmpty() || config.tag.contains(QLatin1Char('/')) || !ok) {
+        std::fprintf(stderr, "convert-watch: bad --tag or --queue\n");
+        return 2;
+    }
+
+    FilePipeline pipeline(config, report);
+
+    if (parser.isSet(onceOpt)) {
+        const QFileInfoList entries = QDir(dir).entryInfoList(QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+        for (const QFileInfo& info : entries) {
+            if (pipeline.accepts(info.absoluteFilePath())) pipeline.submit(info.absoluteFilePath());
+        }
+        pipeline.finish();
+        return failures > 0 ? 1 : 0;
+    }
+
+    FolderWatcher watcher(dir, settleMs, pipeline);
+    if (!watcher.watching()) {
+        std::fprintf(stderr, "convert-watch: cannot watch %s\n", qPrintable(dir));
+        return 1;
+    }
+    std::fprintf(stderr, "convert-watch: watching %s\n", qPrintable(dir));
+    // files in flight when the process is stopped are simply not written: outputs are atomic
+    return app.exec();
+}
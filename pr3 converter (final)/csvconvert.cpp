@@ -0,0 +1,342 @@
+#include "csvconvert.h"
+#include "converter.h"
+#include "numbertext.h"
+
+#include <QThread>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace {
+
+constexpr std::size_t kChunkSize = 4 << 20;
+constexpr std::size_t kReadSize = 1 << 20;
+
+// Hands out whole CSV records; a '\n' only ends a record outside double quotes.
+class RecordReader
+{
+public:
+    explicit RecordReader(std::FILE* in) : in_(in) {}
+
+    // Takes records up to the first record boundary at or past minSize bytes (all remaining
+    // input at the end). Returns false when the input is exhausted or unreadable.
+    bool take(std::string& out, std::size_t minSize)
+    {
+        std::size_t cut = 0;
+        while (cut == 0) {
+            for (; scanned_ < buf_.size(); ++scanned_) {
+                const char c = buf_[scanned_];
+                if (c == '"') inQuotes_ = !inQuotes_;
+                else if (c == '\n' && !inQuotes_ && scanned_ + 1 >= minSize) {
+                    cut = scanned_ + 1;
+                    break;
+                }
+            }
+            if (cut) break;
+            if (eof_) {
+                cut = buf_.size();
+                break;
+            }
+
+            const std::size_t old = buf_.size();
+            buf_.resize(old + kReadSize);
+            const std::size_t n = std::fread(buf_.data() + old, 1, kReadSize, in_);
+            buf_.resize(old + n);
+            if (n == 0) {
+                eof_ = true;
+                failed_ = std::ferror(in_) != 0;
+            }
+        }
+        if (cut == 0 || failed_) return false;
+
+        out.assign(buf_.data(), cut);
+        buf_.erase(0, cut);
+        scanned_ = 0;
+        inQuotes_ = false;
+        return true;
+    }
+
+    bool failed() const { return failed_; }
+
+private:
+    std::FILE* in_;
+    std::string buf_;
+    std::size_t scanned_ = 0;
+    bool inQuotes_ = false;
+    bool eof_ = false;
+    bool failed_ = false;
+};
+
+// Splits one record into unquoted field texts (used for the header only).
+std::vector<QString> splitRecord(const std::string& record)
+{
+    std::vector<QString> fields;
+    std::string field;
+    bool inQuotes = false;
+    for (std::size_t i = 0; i < record.size(); ++i) {
+        const char c = record[i];
+        if (inQuotes) {
+            if (c != '"') field += c;
+            else if (i + 1 < record.size() && record[i + 1] == '"') { field += '"'; ++i; }
+            else inQuotes = false;
+        } else if (c == '"') {
+            inQuotes = true;
+        } else if (c == ',') {
+            fields.push_back(QString::fromUtf8(field));
+            field.clear();
+        } else if (c != '\n' && c != '\r') {
+            field += c;
+        }
+    }
+    fields.push_back(QString::fromUtf8(field));
+    return fields;
+}
+
+struct Chunk {
+    std::uint64_t seq = 0;
+    std::string in;
+    std::string out;
+    std::uint64_t skipped = 0;
+};
+
+// targets[i] holds the conversion for field i, or nullptr if field i is copied through.
+using TargetTable = std::vector<const Converter::Affine*>;
+
+void convertChunk(Chunk& chunk, const TargetTable& targets, const NumberFormat& format)
+{
+    const char* const data = chunk.in.data();
+    const char* const end = data + chunk.in.size();
+    std::string& out = chunk.out;
+    out.clear();
+    out.reserve(chunk.in.size() + chunk.in.size() / 8);
+
+    const char* cursor = data;
+    char num[kMaxNumberChars];
+
+    auto endField = [&](const char* b, const char* e, std::size_t index) {
+        if (index >= targets.size() || !targets[index]) return;
+        trimBlanks(b, e);
+        if (e - b >= 2 && *b == '"' && e[-1] == '"') {
+            ++b;
+            --e;
+            trimBlanks(b, e);
+        }
+        double v = 0.0;
+        if (!parseNumber(b, e, v)) {
+            if (b != e) ++chunk.skipped;
+            return;
+        }
+        out.append(cursor, b);
+        out.append(num, formatNumber(targets[index]->apply(v), num, format));
+        cursor = e;
+    };
+
+    std::size_t index = 0;
+    bool inQuotes = false;
+    const char* fieldStart = data;
+    for (const char* p = data; p < end; ++p) {
+        const char c = *p;
+        if (c == '"') {
+            inQuotes = !inQuotes;
+        } else if (!inQuotes && (c == ',' || c == '\n')) {
+            endField(fieldStart, p, index);
+            index = (c == '\n') ? 0 : index + 1;
+            fieldStart = p + 1;
+        }
+    }
+    if (fieldStart < end) endField(fieldStart, end, index);
+    out.append(cursor, end);
+}
+
+// Chunks are handed to the workers through one queue and collected by sequence number,
+// so the writer can emit them in input order while at most maxInFlight are held in memory.
+class ChunkPool
+{
+public:
+    ChunkPool(const TargetTable& targets, const NumberFormat& format, int threads)
+        : targets_(targets), format_(format)
+    {
+        for (int i = 0; i < threads; ++i)
+            workers_.emplace_back([this]{ work(); });
+    }
+
+    ~ChunkPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        todoReady_.notify_all();
+        for (std::thread& t : workers_) t.join();
+    }
+
+    void submit(std::unique_ptr<Chunk> chunk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            todo_.push_back(std::move(chunk));
+        }
+        todoReady_.notify_one();
+    }
+
+    std::unique_ptr<Chunk> waitFor(std::uint64_t seq)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        doneReady_.wait(lock, [&]{ return done_.count(seq) != 0; });
+        auto node = done_.extract(seq);
+        return std::move(node.mapped());
+    }
+
+private:
+    void work()
+    {
+        for (;;) {
+            std::unique_ptr<Chunk> chunk;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                todoReady_.wait(lock, [&]{ return stopping_ || !todo_.empty(); });
+                if (todo_.empty()) return;
+                chunk = std::move(todo_.front());
+                todo_.pop_front();
+            }
+            convertChunk(*chunk, targets_, format_);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                const std::uint64_t seq = chunk->seq;
+                done_.emplace(seq, std::move(chunk));
+            }
+            doneReady_.notify_all();
+        }
+    }
+
+    const TargetTable& targets_;
+    const NumberFormat format_;
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable todoReady_;
+    std::condition_variable doneReady_;
+    std::deque<std::unique_ptr<Chunk>> todo_;
+    std::map<std::uint64_t, std::unique_ptr<Chunk>> done_;
+    bool stopping_ = false;
+};
+
+// Points targets at the conversion of each named column of header (affines holds them);
+// false if a column is missing.
+bool buildTargets(const std::string& header, const std::vector<CsvColumn>& columns,
+                  std::vector<Converter::Affine>& affines, TargetTable& targets, QString& error)
+{
+    const std::vector<QString> names = splitRecord(header);
+    affines.clear();
+    affines.reserve(columns.size()); // no reallocation: targets point into it
+    targets.assign(names.size(), nullptr);
+    for (const CsvColumn& c : columns) {
+        std::size_t index = 0;
+        while (index < names.size() && names[index] != c.name) ++index;
+        if (index == names.size()) {
+            error = QString("no column named '%1'").arg(c.name);
+            return false;
+        }
+        affines.push_back(Converter::coefficients(c.from, c.to));
+        targets[index] = &affines.back();
+    }
+    return true;
+}
+
+} // namespace
+
+bool convertCsvText(std::string_view in, std::string& out, const std::vector<CsvColumn>& columns,
+                    std::uint64_t& skipped, QString& error, const NumberFormat& format)
+{
+    skipped = 0;
+    out.clear();
+    if (in.empty()) {
+        error = "input is empty";
+        return false;
+    }
+
+    // the header is the first record; a quoted name may contain a newline
+    std::size_t headerEnd = 0;
+    bool inQuotes = false;
+    while (headerEnd < in.size() && (in[headerEnd] != '\n' || inQuotes)) {
+        if (in[headerEnd] == '"') inQuotes = !inQuotes;
+        ++headerEnd;
+    }
+    if (headerEnd < in.size()) ++headerEnd;
+    const std::string header(in.substr(0, headerEnd));
+
+    std::vector<Converter::Affine> affines;
+    TargetTable targets;
+    if (!buildTargets(header, columns, affines, targets, error)) return false;
+
+    Chunk chunk;
+    chunk.in.assign(in.substr(headerEnd));
+    convertChunk(chunk, targets, format);
+    skipped = chunk.skipped;
+    out.reserve(header.size() + chunk.out.size());
+    out.append(header);
+    out.append(chunk.out);
+    return true;
+}
+
+bool convertCsvStream(std::FILE* in, std::FILE* out, const std::vector<CsvColumn>& columns,
+                      int threads, std::uint64_t& skipped, QString& error,
+                      const NumberFormat& format)
+{
+    skipped = 0;
+    RecordReader reader(in);
+
+    std::string header;
+    if (!reader.take(header, 1)) {
+        error = reader.failed() ? "read failed" : "input is empty";
+        return false;
+    }
+
+    std::vector<Converter::Affine> affines;
+    TargetTable targets;
+    if (!buildTargets(header, columns, affines, targets, error)) return false;
+
+    if (std::fwrite(header.data(), 1, header.size(), out) != header.size()) {
+        error = "write failed";
+        return false;
+    }
+
+    if (threads <= 0) threads = QThread::idealThreadCount();
+    threads = std::max(threads, 1);
+    const std::uint64_t maxInFlight = std::uint64_t(threads) * 2;
+
+    ChunkPool pool(targets, format, threads);
+    std::uint64_t nextRead = 0;
+    std::uint64_t nextWrite = 0;
+    bool inputDone = false;
+
+    while (!inputDone || nextWrite < nextRead) {
+        while (!inputDone && nextRead - nextWrite < maxInFlight) {
+            auto chunk = std::make_unique<Chunk>();
+            if (!reader.take(chunk->in, kChunkSize)) {
+                inputDone = true;
+                break;
+            }
+            chunk->seq = nextRead++;
+            pool.submit(std::move(chunk));
+        }
+        if (nextWrite == nextRead) break;
+
+        const std::unique_ptr<Chunk> chunk = pool.waitFor(nextWrite++);
+        skipped += chunk->skipped;
+        if (std::fwrite(chunk->out.data(), 1, chunk->out.size(), out) != chunk->out.size()) {
+            error = "write failed";
+            return false;
+        }
+    }
+
+    if (reader.failed()) {
+        error = "read failed";
+        return false;
+    }
+    return true;
+}
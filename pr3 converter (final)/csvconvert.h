@@ -0,0 +1,29 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "numbertext.h"
+#include "unitregistry.h"
+
+struct CsvColumn {
+    QString name;
+    UnitId from = UnitId::Invalid;
+    UnitId to = UnitId::Invalid;
+};
+
+// Converts the named columns of a CSV stream; the header row names the columns and every other
+// byte is copied through unchanged. Records are cut into ~4 MiB chunks on record boundaries
+// (quoted fields may contain separators and newlines), converted on a pool of threads and
+// written back in input order. Empty or non-numeric fields in the named columns are left as
+// they are and counted in skipped. threads <= 0 uses the ideal thread count.
+bool convertCsvStream(std::FILE* in, std::FILE* out, const std::vector<CsvColumn>& columns,
+                      int threads, std::uint64_t& skipped, QString& error,
+                      const NumberFormat& format = {});
+
+// The same conversion over a whole file already in memory, on the calling thread; for
+// callers that convert many small files concurrently (see filepipeline.h).
+bool convertCsvText(std::string_view in, std::string& out, const std::vector<CsvColumn>& columns,
+                    std::uint64_t& skipped, QString& error, const NumberFormat& format = {});
@@ -0,0 +1,442 @@
+#include "decimalconvert.h"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+using affine_detail::DD;
+using affine_detail::kExactPow10;
+
+constexpr std::uint32_t kPow10U32[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000 };
+
+// Just enough unsigned bignum for the exact fallback: the operands are catalogue integers
+// (below 2^53), a 17-digit input and powers of ten.
+class BigUint
+{
+public:
+    BigUint() = default;
+    explicit BigUint(std::uint64_t v)
+    {
+        for (; v; v >>= 32) limbs_.push_back(std::uint32_t(v));
+    }
+
+    bool isZero() const { return limbs_.empty(); }
+
+    std::size_t bitLength() const
+    {
+        if (limbs_.empty()) return 0;
+        return (limbs_.size() - 1) * 32 + std::size_t(32 - std::countl_zero(limbs_.back()));
+    }
+
+    void mulSmall(std::uint32_t m)
+    {
+        std::uint64_t carry = 0;
+        for (std::uint32_t& limb : limbs_) {
+            const std::uint64_t t = std::uint64_t(limb) * m + carry;
+            limb = std::uint32_t(t);
+            carry = t >> 32;
+        }
+        if (carry) limbs_.push_back(std::uint32_t(carry));
+        trim();
+    }
+
+    void mulPow10(int n)
+    {
+        for (; n >= 9; n -= 9) mulSmall(kPow10U32[9]);
+        if (n > 0) mulSmall(kPow10U32[n]);
+    }
+
+    void mul(const BigUint& o)
+    {
+        std::vector<std::uint32_t> r(limbs_.size() + o.limbs_.size(), 0);
+        for (std::size_t i = 0; i < limbs_.size(); ++i) {
+            std::uint64_t carry = 0;
+            for (std::size_t j = 0; j < o.limbs_.size(); ++j) {
+                const std::uint64_t t = std::uint64_t(limbs_[i]) * o.limbs_[j] + r[i + j] + carry;
+                r[i + j] = std::uint32_t(t);
+                carry = t >> 32;
+            }
+            r[i + o.limbs_.size()] = std::uint32_t(carry);
+        }
+        limbs_.swap(r);
+        trim();
+    }
+
+    void add(const BigUint& o)
+    {
+        if (limbs_.size() < o.limbs_.size()) limbs_.resize(o.limbs_.size(), 0);
+        std::uint64_t carry = 0;
+        for (std::size_t i = 0; i < limbs_.size(); ++i) {
+            const std::uint64_t t = std::uint64_t(limbs_[i]) + (i < o.limbs_.size() ? o.limbs_[i] : 0) + carry;
+            limbs_[i] = std::uint32_t(t);
+            carry = t >> 32;
+        }
+        if (carry) limbs_.push_back(std::uint32_t(carry));
+    }
+
+    // *this -= o; *this must not be smaller.
+    void sub(const BigUint& o)
+    {
+        std::int64_t borrow = 0;
+        for (std::size_t i = 0; i < limbs_.size(); ++i) {
+            std::int64_t t = std::int64_t(limbs_[i]) - (i < o.limbs_.size() ? o.limbs_[i] : 0) - borrow;
+            borrow = t < 0;
+            if (t < 0) t += std::int64_t(1) << 32;
+            limbs_[i] = std::uint32_t(t);
+        }
+        trim();
+    }
+
+    BigUint shiftedLeft(unsigned bits) const
+    {
+        BigUint r;
+        if (isZero()) return r;
+        const unsigned words = bits / 32;
+        const unsigned shift = bits % 32;
+        r.limbs_.assign(words, 0);
+        std::uint32_t carry = 0;
+        for (const std::uint32_t limb : limbs_) {
+            r.limbs_.push_back(shift ? (limb << shift) | carry : limb);
+            carry = shift ? limb >> (32 - shift) : 0;
+        }
+        if (carry) r.limbs_.push_back(carry);
+        return r;
+    }
+
+    friend int compare(const BigUint& a, const BigUint& b)
+    {
+        if (a.limbs_.size() != b.limbs_.size()) return a.limbs_.size() < b.limbs_.size() ? -1 : 1;
+        for (std::size_t i = a.limbs_.size(); i-- > 0;) {
+            if (a.limbs_[i] != b.limbs_[i]) return a.limbs_[i] < b.limbs_[i] ? -1 : 1;
+        }
+        return 0;
+    }
+
+private:
+    std::vector<std::uint32_t> limbs_; // little-endian, no leading zero limbs
+
+    void trim()
+    {
+        while (!limbs_.empty() && limbs_.back() == 0) limbs_.pop_back();
+    }
+};
+
+// (negative ? -1 : 1) * num / den * 10^exp10
+struct Fraction {
+    bool negative = false;
+    BigUint num;
+    BigUint den{ 1 };
+    int exp10 = 0;
+};
+
+// Catalogue ratios hold integers below 2^53 (unitgen checks this).
+Fraction toFraction(const Ratio& r)
+{
+    Fraction f;
+    f.negative = (r.num < 0) != (r.den < 0);
+    f.num = BigUint(std::uint64_t(std::fabs(r.num)));
+    f.den = BigUint(std::uint64_t(std::fabs(r.den)));
+    f.exp10 = r.exp10;
+    return f;
+}
+
+Fraction multiply(Fraction a, const Fraction& b)
+{
+    a.negative = a.negative != b.negative;
+    a.num.mul(b.num);
+    a.den.mul(b.den);
+    a.exp10 += b.exp10;
+    return a;
+}
+
+Fraction divide(Fraction a, const Fraction& b)
+{
+    a.negative = a.negative != b.negative;
+    a.num.mul(b.den);
+    a.den.mul(b.num);
+    a.exp10 -= b.exp10;
+    return a;
+}
+
+Fraction add(const Fraction& a, const Fraction& b)
+{
+    if (b.num.isZero()) return a;
+    if (a.num.isZero()) return b;
+    Fraction r;
+    r.exp10 = std::min(a.exp10, b.exp10);
+    BigUint an = a.num;
+    an.mul(b.den);
+    an.mulPow10(a.exp10 - r.exp10);
+    BigUint bn = b.num;
+    bn.mul(a.den);
+    bn.mulPow10(b.exp10 - r.exp10);
+    if (a.negative == b.negative) {
+        an.add(bn);
+        r.num = an;
+        r.negative = a.negative;
+    } else if (compare(an, bn) >= 0) {
+        an.sub(bn);
+        r.num = an;
+        r.negative = a.negative;
+    } else {
+        bn.sub(an);
+        r.num = bn;
+        r.negative = b.negative;
+    }
+    r.den = a.den;
+    r.den.mul(b.den);
+    return r;
+}
+
+// Compares num / den * 10^exp10 (all non-negative) with 10^e.
+int comparePow10(const Fraction& f, int e)
+{
+    BigUint lhs = f.num;
+    BigUint rhs = f.den;
+    if (f.exp10 >= e) lhs.mulPow10(f.exp10 - e);
+    else rhs.mulPow10(e - f.exp10);
+    return compare(lhs, rhs);
+}
+
+// Input decimals are the shortest that read back to the double, so at most 17 digits.
+Fraction shortestDecimal(double v)
+{
+    char buf[32];
+    const char* end = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::scientific).ptr;
+    Fraction f;
+    const char* p = buf;
+    if (*p == '-') {
+        f.negative = true;
+        ++p;
+    }
+    std::uint64_t digits = 0;
+    int fractionDigits = 0;
+    bool afterPoint = false;
+    for (; p < end && *p != 'e'; ++p) {
+        if (*p == '.') {
+            afterPoint = true;
+            continue;
+        }
+        digits = digits * 10 + std::uint64_t(*p - '0');
+        fractionDigits += afterPoint;
+    }
+    int exponent = 0;
+    if (p < end) std::from_chars(p + 1 + (p[1] == '+'), end, exponent);
+    f.num = BigUint(digits);
+    f.exp10 = exponent - fractionDigits;
+    return f;
+}
+
+// floor(log10(a)) for a double, possibly one too small or large; callers correct it.
+int decimalExponentEstimate(double a)
+{
+    const int e2 = int((std::bit_cast<std::uint64_t>(a) >> 52) & 0x7ff) - 1023;
+    return (e2 * 1233) >> 12; // log10(2) ~ 1233 / 4096
+}
+
+} // namespace
+
+double DecimalValue::toDouble() const
+{
+    // coefficient < 2^53 and an exact power of ten: one correctly rounded operation
+    double v = 0.0;
+    if (exp10 >= 0 && exp10 <= 22) {
+        v = double(coefficient) * kExactPow10[exp10];
+    } else if (exp10 < 0 && exp10 >= -22) {
+        v = double(coefficient) / kExactPow10[-exp10];
+    } else {
+        char buf[48];
+        char* end = std::to_chars(buf, buf + 24, coefficient).ptr;
+        *end++ = 'e';
+        end = std::to_chars(end, buf + sizeof(buf), exp10).ptr;
+        std::from_chars(buf, end, v);
+    }
+    return negative ? -v : v;
+}
+
+DecimalConverter::DecimalConverter(UnitId from, UnitId to, DecimalRounding rounding)
+    : from_(from)
+    , to_(to)
+    , rounding_(rounding)
+    , affine_(foldAffineDD(unitInfo(from), unitInfo(to)))
+{
+    const int low = rounding_.style == DecimalRounding::Style::Significant ? 1 : 0;
+    rounding_.digits = std::clamp(rounding_.digits, low, kMaxDecimalDigits);
+    for (std::size_t j = 0; j < scaleByPow10_.size(); ++j) {
+        scaleByPow10_[j] = affine_detail::ddDiv(affine_.scale, kExactPow10[j]);
+    }
+}
+
+int DecimalConverter::roundingExponent(int e) const
+{
+    // the coefficient keeps at most kMaxDecimalDigits digits either way
+    const int significant = e - (rounding_.style == DecimalRounding::Style::Significant
+                                 ? rounding_.digits : kMaxDecimalDigits) + 1;
+    return rounding_.style == DecimalRounding::Style::Significant ? significant
+                                                                   : std::max(-rounding_.digits, significant);
+}
+
+std::uint64_t DecimalConverter::coefficientLimit() const
+{
+    return std::uint64_t(kExactPow10[rounding_.style == DecimalRounding::Style::Significant
+                                     ? rounding_.digits : kMaxDecimalDigits]);
+}
+
+bool DecimalConverter::convert(double value, DecimalValue& out) const
+{
+    if (!std::isfinite(value)) return false;
+    if (!convertFast(value, out)) convertExact(value, out);
+    return true;
+}
+
+std::size_t DecimalConverter::convert(std::span<const double> in, std::span<double> out) const
+{
+    std::size_t exact = 0;
+    for (std::size_t i = 0; i < in.size(); ++i) {
+        const double v = in[i];
+        if (!std::isfinite(v)) {
+            out[i] = Affine{ affine_.scale.hi, affine_.offset.hi }.apply(v);
+            continue;
+        }
+        DecimalValue d;
+        if (!convertFast(v, d)) {
+            convertExact(v, d);
+            ++exact;
+        }
+        out[i] = d.toDouble();
+    }
+    return exact;
+}
+
+bool DecimalConverter::convertFast(double v, DecimalValue& out) const
+{
+    using namespace affine_detail;
+
+    // The input's decimal m / 10^j, if it has few enough digits for m to be an exact double:
+    // the fewest fraction digits j for which the integer nearest v * 10^j reads back as v.
+    const double magnitude = std::fabs(v);
+    double m = -1;
+    int j = 0;
+    for (; j <= 22; ++j) {
+        const DD p = twoProd(magnitude, kExactPow10[j]); // exact
+        if (p.hi >= 0x1p53) break;
+        double n = double(std::int64_t(p.hi));
+        const double rest = (p.hi - n) + p.lo;
+        if (rest == 0.5 || rest == -0.5) break; // two candidates; leave it to the exact path
+        n += rest > 0.5 ? 1 : rest < -0.5 ? -1 : 0;
+        if (n / kExactPow10[j] == magnitude) {
+            m = n;
+            break;
+        }
+    }
+
+    // r = input * scale + offset in double-double, with a bound on |r - exact|. The folded
+    // coefficients and the arithmetic are good to about 2^-100; an input without a short
+    // decimal stands for one up to half an ulp away from it.
+    DD r;
+    double bound;
+    if (m >= 0) {
+        const DD scale = scaleByPow10_[j];
+        const double input = std::copysign(m, v);
+        const DD p = twoProd(input, scale.hi);
+        const DD s = twoSum(p.hi, affine_.offset.hi);
+        r = quickTwoSum(s.hi, s.lo + p.lo + input * scale.lo + affine_.offset.lo);
+        bound = (std::fabs(p.hi) + std::fabs(affine_.offset.hi)) * 0x1p-96;
+    } else {
+        const DD p = twoProd(v, affine_.scale.hi);
+        const DD s = twoSum(p.hi, affine_.offset.hi);
+        r = quickTwoSum(s.hi, s.lo + p.lo + v * affine_.scale.lo + affine_.offset.lo);
+        bound = std::fabs(p.hi) * 0x1p-52 + (std::fabs(p.hi) + std::fabs(affine_.offset.hi)) * 0x1p-96;
+    }
+
+    const double a = std::fabs(r.hi);
+    if (a <= bound) return false; // the result may be zero or of any magnitude
+
+    // x = |r| / 10^rho, the coefficient before rounding
+    int e = decimalExponentEstimate(a);
+    int rho = 0;
+    DD x{};
+    for (int attempt = 0;; ++attempt) {
+        rho = roundingExponent(e);
+        const int digits = e - rho; // x should lie in [10^digits, 10^(digits + 1))
+        if (rho < -22 || rho > 22 || digits < 0 || digits + 1 > 22 || attempt == 3) return false;
+        x = rho <= 0 ? ddMul(r, kExactPow10[-rho]) : ddDiv(r, kExactPow10[rho]);
+        if (x.hi < 0) x = { -x.hi, -x.lo };
+        if (x.hi < kExactPow10[digits]) --e;
+        else if (x.hi >= kExactPow10[digits + 1]) ++e;
+        else break;
+    }
+
+    const double scaled = rho <= 0 ? bound * kExactPow10[-rho] : bound / kExactPow10[rho];
+    const double xBound = scaled * (1 + 0x1p-50) + x.hi * 0x1p-100;
+    // too close to the decade boundary to be sure of e (and so of where to round)
+    if (x.hi - kExactPow10[e - rho] <= xBound) return false;
+
+    double whole = double(std::int64_t(x.hi)); // x.hi < 10^15
+    double fraction = (x.hi - whole) + x.lo;
+    if (fraction < 0) {
+        whole -= 1;
+        fraction += 1;
+    } else if (fraction >= 1) {
+        whole += 1;
+        fraction -= 1;
+    }
+    // the exact value could lie on the other side of the rounding midpoint
+    if (std::fabs(fraction - 0.5) <= xBound) return false;
+
+    std::uint64_t n = std::uint64_t(whole) + (fraction > 0.5);
+    if (n >= coefficientLimit()) { // 9.99.. rounded up to 10
+        n /= 10;
+        ++rho;
+    }
+    out = { r.hi < 0 && n != 0, n, rho };
+    return true;
+}
+
+void DecimalConverter::convertExact(double v, DecimalValue& out) const
+{
+    const UnitInfo& from = unitInfo(from_);
+    const UnitInfo& to = unitInfo(to_);
+
+    // (value * s1 + o1 - o2) / s2, exactly
+    Fraction offsetTo = toFraction(to.offset);
+    offsetTo.negative = !offsetTo.negative;
+    Fraction base = add(add(multiply(shortestDecimal(v), toFraction(from.scale)), toFraction(from.offset)), offsetTo);
+    const Fraction result = divide(base, toFraction(to.scale));
+
+    out = {};
+    if (result.num.isZero()) return;
+
+    // leading digit position: estimated from the bit lengths, then corrected
+    int e = result.exp10 + int(std::floor((double(result.num.bitLength()) - double(result.den.bitLength())) * 0.30103));
+    while (comparePow10(result, e) < 0) --e;
+    while (comparePow10(result, e + 1) >= 0) ++e;
+    int rho = roundingExponent(e);
+
+    // quotient and remainder of num * 10^exp10 / (den * 10^rho); the quotient is below 10^16
+    BigUint num = result.num;
+    BigUint den = result.den;
+    if (result.exp10 >= rho) num.mulPow10(result.exp10 - rho);
+    else den.mulPow10(rho - result.exp10);
+    std::uint64_t n = 0;
+    for (int bit = 54; bit >= 0; --bit) {
+        const BigUint d = den.shiftedLeft(unsigned(bit));
+        if (compare(num, d) >= 0) {
+            num.sub(d);
+            n |= std::uint64_t(1) << bit;
+        }
+    }
+
+    // half to even
+    const int half = compare(num.shiftedLeft(1), den);
+    if (half > 0 || (half == 0 && (n & 1))) ++n;
+    if (n >= coefficientLimit()) {
+        n /= 10;
+        ++rho;
+    }
+    out = { result.negative && n != 0, n, rho };
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include "affine.h"
+#include "unitregistry.h"
+
+// Most significant digits an exact result carries: every decimal of up to 15 digits survives
+// the trip through the nearest double and back.
+inline constexpr int kMaxDecimalDigits = 15;
+
+struct DecimalRounding {
+    enum class Style : std::uint8_t {
+        Significant, // digits significant digits
+        Fixed        // digits after the point, but never more than kMaxDecimalDigits in all
+    };
+
+    Style style = Style::Significant;
+    int digits = kMaxDecimalDigits; // clamped to 1..15 (Significant) or 0..15 (Fixed)
+
+    friend bool operator==(const DecimalRounding&, const DecimalRounding&) = default;
+};
+
+// negative ? -1 : 1 times coefficient * 10^exp10, exactly.
+struct DecimalValue {
+    bool negative = false;
+    std::uint64_t coefficient = 0; // below 10^kMaxDecimalDigits
+    int exp10 = 0;
+
+    // The nearest double (formatNumber prints it back as this decimal).
+    double toDouble() const;
+};
+
+// Unit conversion rounded correctly to a decimal precision, so 0.1 in -> m is 0.00254 and
+// 37 C -> F is 98.6, not the double arithmetic's 0.0025400000000000002 and 98.60000000000001.
+//
+// An input double stands for the shortest decimal that reads back to it (0.1 is 1/10). The
+// exact result of converting that decimal with the catalogue's exact ratios is rounded to
+// the requested precision, half to even. Each value is first computed in double-double
+// together with a bound on its error; only when the rounding could go either way within
+// that bound (the result sits almost exactly on a rounding midpoint, or is too large or
+// small for the fast path) is it recomputed in exact rational arithmetic. With the default
+// 15 digits that is a small fraction of non-integer inputs; with 12 or fewer, almost none.
+class DecimalConverter
+{
+public:
+    // Both units must be valid and of one mode.
+    DecimalConverter(UnitId from, UnitId to, DecimalRounding rounding = {});
+
+    UnitId from() const { return from_; }
+    UnitId to() const { return to_; }
+    const DecimalRounding& rounding() const { return rounding_; }
+
+    // False (out untouched) if value is not finite.
+    bool convert(double value, DecimalValue& out) const;
+
+    // out[i] = convert(in[i]).toDouble(); non-finite values convert as plain doubles.
+    // out must be at least as long as in (they may be the same buffer). Returns how many
+    // values took the exact fallback.
+    std::size_t convert(std::span<const double> in, std::span<double> out) const;
+
+private:
+    UnitId from_;
+    UnitId to_;
+    DecimalRounding rounding_;
+    AffineDD affine_;
+    std::array<affine_detail::DD, 23> scaleByPow10_; // scale / 10^j, for inputs m / 10^j
+
+    bool convertFast(double value, DecimalValue& out) const;
+    void convertExact(double value, DecimalValue& out) const;
+    // The exponent rounding happens at, for a result whose leading digit is at 10^e.
+    int roundingExponent(int e) const;
+    // Coefficients reaching this after rounding up (999.5 -> 1000) drop a trailing zero.
+    std::uint64_t coefficientLimit() const;
+};
@@ -0,0 +1,318 @@
+#include "derivedunit.h"
+#include "unitindex.h"
+
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+UnitId lookupUnit(std::string_view name)
+{
+    if (name.empty()) return UnitId::Invalid;
+    return exactUnitName(name);
+}
+
+// Superscript digit or minus at text[i] (all are multi-byte UTF-8): its value, -1 for '⁻',
+// and its length in n; false if there is none.
+bool superscriptAt(std::string_view text, std::size_t i, int& value, std::size_t& n)
+{
+    const auto at = [&](std::size_t k) { return i + k < text.size() ? static_cast<unsigned char>(text[i + k]) : 0u; };
+    if (at(0) == 0xC2 && (at(1) == 0xB2 || at(1) == 0xB3 || at(1) == 0xB9)) { // ² ³ ¹
+        value = at(1) == 0xB2 ? 2 : at(1) == 0xB3 ? 3 : 1;
+        n = 2;
+        return true;
+    }
+    if (at(0) == 0xE2 && at(1) == 0x81 && (at(2) == 0xB0 || (at(2) >= 0xB4 && at(2) <= 0xB9) || at(2) == 0xBB)) {
+        value = at(2) == 0xBB ? -1 : int(at(2) - 0xB0); // ⁰ ⁴-⁹, ⁻
+        n = 3;
+        return true;
+    }
+    return false;
+}
+
+// Length of a multiplication sign at text[i]: '*', ' ', '·' or '⋅'; 0 if none.
+std::size_t timesAt(std::string_view text, std::size_t i)
+{
+    if (text[i] == '*' || text[i] == ' ' || text[i] == '\t') return 1;
+    if (text.substr(i, 2) == "\xC2\xB7") return 2;      // ·
+    if (text.substr(i, 3) == "\xE2\x8B\x85") return 3;  // ⋅
+    return 0;
+}
+
+} // namespace
+
+class DerivedUnitParser
+{
+public:
+    DerivedUnitParser(std::string_view text, DerivedUnit& out) : text_(text), out_(out) {}
+
+    DerivedUnitError run()
+    {
+        if (!product(1)) return error_;
+        skipBlanks();
+        if (pos_ != text_.size()) return DerivedUnitError::Syntax;
+        if (out_.count_ == 0) return DerivedUnitError::Syntax;
+        return DerivedUnitError::None;
+    }
+
+private:
+    std::string_view text_;
+    DerivedUnit& out_;
+    std::size_t pos_ = 0;
+    DerivedUnitError error_ = DerivedUnitError::None;
+
+    bool fail(DerivedUnitError e)
+    {
+        if (error_ == DerivedUnitError::None) error_ = e;
+        return false;
+    }
+
+    void skipBlanks()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) ++pos_;
+    }
+
+    bool atFactorEnd(std::size_t i) const
+    {
+        return i == text_.size() || text_[i] == '/' || text_[i] == '(' || text_[i] == ')' || text_[i] == '^'
+               || timesAt(text_, i) != 0;
+    }
+
+    // factor (('*' | '/') factor)*, every exponent multiplied by sign
+    bool product(int sign)
+    {
+        skipBlanks();
+        if (!factor(sign)) return false;
+        for (;;) {
+            skipBlanks();
+            if (pos_ == text_.size() || text_[pos_] == ')') return true;
+            int next = sign;
+            if (text_[pos_] == '/') {
+                next = -sign;
+                ++pos_;
+            } else if (const std::size_t n = timesAt(text_, pos_)) {
+                pos_ += n;
+            }
+            skipBlanks();
+            if (!factor(next)) return false;
+        }
+    }
+
+    bool factor(int sign)
+    {
+        if (pos_ < text_.size() && text_[pos_] == '(') {
+            ++pos_;
+            if (!product(sign)) return false;
+            if (pos_ == text_.size() || text_[pos_] != ')') return fail(DerivedUnitError::Syntax);
+            ++pos_;
+            return true;
+        }
+
+        const std::size_t start = pos_;
+        while (!atFactorEnd(pos_)) ++pos_;
+        if (pos_ == start) return fail(DerivedUnitError::Syntax);
+        const std::string_view name = text_.substr(start, pos_ - start);
+        if (name == "1") return true; // "1/s"
+
+        int exponent = 1;
+        UnitId id = lookupUnit(name);
+        if (!isValidUnit(id) && !splitPower(name, exponent, id)) return fail(DerivedUnitError::UnknownUnit);
+        if (pos_ < text_.size() && text_[pos_] == '^') {
+            int power = 0;
+            const auto r = std::from_chars(text_.data() + pos_ + 1, text_.data() + text_.size(), power);
+            if (r.ec != std::errc() || power == 0 || power < -DerivedUnit::kMaxExponent || power > DerivedUnit::kMaxExponent)
+                return fail(DerivedUnitError::Syntax);
+            pos_ = std::size_t(r.ptr - text_.data());
+            exponent *= power;
+        }
+        return out_.addTerm(id, sign * exponent) || fail(DerivedUnitError::TooManyTerms);
+    }
+
+    // "m²", "s⁻¹", "s2": a unit name followed by a power written without '^'.
+    static bool splitPower(std::string_view name, int& exponent, UnitId& id)
+    {
+        std::size_t cut = name.size();
+        while (cut > 0 && name[cut - 1] >= '0' && name[cut - 1] <= '9') --cut;
+        if (cut == name.size()) {
+            // superscripts: find the first one and read the rest as a superscript number
+            for (cut = 0; cut < name.size(); ++cut) {
+                int v = 0;
+                std::size_t n = 0;
+                if (superscriptAt(name, cut, v, n)) break;
+            }
+            if (cut == name.size()) return false;
+            int power = 0;
+            bool negative = false;
+            bool digits = false;
+            for (std::size_t i = cut; i < name.size();) {
+                int v = 0;
+                std::size_t n = 0;
+                if (!superscriptAt(name, i, v, n)) return false;
+                if (v < 0) {
+                    if (i != cut) return false;
+                    negative = true;
+                } else {
+                    power = power * 10 + v;
+                    digits = true;
+                }
+                i += n;
+            }
+            if (!digits || power == 0 || power > DerivedUnit::kMaxExponent) return false;
+            exponent = negative ? -power : power;
+        } else {
+            if (cut == 0 || name.size() - cut > 2) return false;
+            std::from_chars(name.data() + cut, name.data() + name.size(), exponent);
+            if (exponent == 0) return false;
+        }
+        id = lookupUnit(name.substr(0, cut));
+        return isValidUnit(id);
+    }
+};
+
+bool DerivedUnit::addTerm(UnitId unit, int exponent)
+{
+    Term* end = terms_.data() + count_;
+    Term* it = std::lower_bound(terms_.data(), end, unit, [](const Term& t, UnitId u) { return t.unit < u; });
+    if (it != end && it->unit == unit) {
+        const int sum = it->exponent + exponent;
+        if (sum < -kMaxExponent || sum > kMaxExponent) return false;
+        if (sum == 0) {
+            std::copy(it + 1, end, it);
+            --count_;
+        } else {
+            it->exponent = std::int8_t(sum);
+        }
+        return true;
+    }
+    if (count_ == kMaxTerms || exponent < -kMaxExponent || exponent > kMaxExponent) return false;
+    std::copy_backward(it, end, end + 1);
+    *it = { unit, std::int8_t(exponent) };
+    ++count_;
+    return true;
+}
+
+bool DerivedUnit::computeDimensions()
+{
+    dims_ = {};
+    for (const Term& t : terms()) {
+        const Dimensions& unitDims = modeDimensions(unitInfo(t.unit).mode);
+        for (std::size_t d = 0; d < kBaseDimensionCount; ++d) {
+            const int e = dims_.exponent[d] + unitDims.exponent[d] * t.exponent;
+            if (e < -kMaxExponent || e > kMaxExponent) return false;
+            dims_.exponent[d] = std::int8_t(e);
+        }
+    }
+    return true;
+}
+
+DerivedUnitError DerivedUnit::parse(std::string_view text, DerivedUnit& out)
+{
+    out = DerivedUnit();
+    // a catalogue name is taken whole, even if it looks like a compound ("km/h", "m2")
+    if (const UnitId id = lookupUnit(text); isValidUnit(id)) {
+        out = fromUnit(id);
+        return DerivedUnitError::None;
+    }
+
+    DerivedUnitError e = DerivedUnitParser(text, out).run();
+    if (e == DerivedUnitError::None && !out.computeDimensions()) e = DerivedUnitError::TooManyTerms;
+    if (e != DerivedUnitError::None) out = DerivedUnit();
+    return e;
+}
+
+DerivedUnit DerivedUnit::fromUnit(UnitId unit)
+{
+    DerivedUnit u;
+    u.terms_[0] = { unit, 1 };
+    u.count_ = 1;
+    u.dims_ = modeDimensions(unitInfo(unit).mode);
+    return u;
+}
+
+namespace {
+
+// Product of scale^exponent over terms (negated with invert), folded in double-double:
+// numerators and denominators are exact, so only the powers of ten and the final
+// rounding lose anything.
+affine_detail::DD termProduct(affine_detail::DD v, std::span<const DerivedUnit::Term> terms, bool invert, int& exp10)
+{
+    using namespace affine_detail;
+    for (const DerivedUnit::Term& t : terms) {
+        const Ratio& r = unitInfo(t.unit).scale;
+        const int e = invert ? -t.exponent : t.exponent;
+        for (int k = 0; k < (e < 0 ? -e : e); ++k)
+            v = e > 0 ? ddDiv(ddMul(v, r.num), r.den) : ddDiv(ddMul(v, r.den), r.num);
+        exp10 += e * r.exp10;
+    }
+    return v;
+}
+
+} // namespace
+
+double DerivedUnit::scale() const
+{
+    int exp10 = 0;
+    const affine_detail::DD v = termProduct({ 1.0, 0.0 }, terms(), false, exp10);
+    return affine_detail::ddScalePow10(v, exp10).hi;
+}
+
+std::uint64_t DerivedUnit::signature() const
+{
+    std::uint64_t h = 0xcbf29ce484222325ull; // FNV-1a over (unit, exponent) pairs
+    for (const Term& t : terms()) {
+        for (const std::uint32_t byte : { std::uint32_t(t.unit) & 0xFF, std::uint32_t(t.unit) >> 8,
+                                          std::uint32_t(std::uint8_t(t.exponent)) }) {
+            h ^= byte;
+            h *= 0x100000001b3ull;
+        }
+    }
+    return h;
+}
+
+namespace {
+
+struct FactorKey {
+    DerivedUnit from;
+    DerivedUnit to;
+
+    friend bool operator==(const FactorKey&, const FactorKey&) = default;
+};
+
+struct FactorKeyHash {
+    std::size_t operator()(const FactorKey& k) const noexcept
+    {
+        return std::size_t(k.from.signature() * 31 ^ k.to.signature());
+    }
+};
+
+// Distinct unit pairs are few in practice; on overflow the cache simply starts over.
+constexpr std::size_t kMaxCachedFactors = 4096;
+
+} // namespace
+
+DerivedUnitError derivedFactor(const DerivedUnit& from, const DerivedUnit& to, double& factor)
+{
+    if (from.dimensions() != to.dimensions()) return DerivedUnitError::DimensionMismatch;
+
+    static std::mutex mutex;
+    static std::unordered_map<FactorKey, double, FactorKeyHash> cache;
+
+    const FactorKey key{ from, to };
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (const auto it = cache.find(key); it != cache.end()) {
+        factor = it->second;
+        return DerivedUnitError::None;
+    }
+
+    // from's scale over to's, as one product so it is rounded once
+    int exp10 = 0;
+    affine_detail::DD v = termProduct({ 1.0, 0.0 }, from.terms(), false, exp10);
+    v = termProduct(v, to.terms(), true, exp10);
+    factor = affine_detail::ddScalePow10(v, exp10).hi;
+
+    if (cache.size() >= kMaxCachedFactors) cache.clear();
+    cache.emplace(key, factor);
+    return DerivedUnitError::None;
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include "unitregistry.h"
+
+enum class DerivedUnitError : std::uint8_t {
+    None,
+    Syntax,            // empty factor, bad exponent, unbalanced parenthesis
+    UnknownUnit,
+    TooManyTerms,      // more than DerivedUnit::kMaxTerms distinct units, or an exponent overflow
+    DimensionMismatch  // derivedFactor between units of different dimensions
+};
+
+// A product of catalogue units raised to integer powers, written as
+//
+//     km/h    kg·m²    N*m    mi/gal    m/s^2    J/(kg K)    s⁻¹
+//
+// '*', '·', '⋅' and blanks multiply, '/' divides by the next factor or parenthesised group,
+// and a power is ^n, ^-n, superscript digits, or trailing digits when the name alone is
+// not a unit ("s2"; but "m2" is the catalogue's square meter). A catalogue key or alias
+// always wins over splitting it, so "km/h" stays one unit; other case spellings of a name
+// match only when exactly one unit has it (see exactUnitName). Units with an offset count as
+// temperature differences here (°C in J/(kg °C) is a kelvin).
+//
+// Dimensions come from each unit's mode (units.catalog dim=), so any two units with equal
+// dimensions convert, whether or not a mode has them (mi/gal and km/L do not).
+class DerivedUnit
+{
+public:
+    static constexpr std::size_t kMaxTerms = 8;
+    static constexpr int kMaxExponent = 99;
+
+    struct Term {
+        UnitId unit = UnitId::Invalid;
+        std::int8_t exponent = 0;
+
+        friend constexpr bool operator==(const Term&, const Term&) = default;
+    };
+
+    static DerivedUnitError parse(std::string_view text, DerivedUnit& out);
+    static DerivedUnit fromUnit(UnitId unit);
+
+    const Dimensions& dimensions() const { return dims_; }
+
+    // The catalogue mode with these dimensions, if any.
+    std::optional<UnitMode> mode() const { return modeForDimensions(dims_); }
+
+    // Sorted by unit ID, one per unit, no zero exponents: equal units compare equal.
+    std::span<const Term> terms() const { return { terms_.data(), count_ }; }
+
+    // One of this unit in the coherent unit of its dimensions (m, kg, s, K, B, deg products).
+    double scale() const;
+
+    // Hash of terms(); what derivedFactor's cache is keyed by.
+    std::uint64_t signature() const;
+
+    friend bool operator==(const DerivedUnit& a, const DerivedUnit& b)
+    {
+        return a.count_ == b.count_ && std::equal(a.terms_.begin(), a.terms_.begin() + a.count_, b.terms_.begin());
+    }
+
+private:
+    std::array<Term, kMaxTerms> terms_{};
+    std::uint8_t count_ = 0;
+    Dimensions dims_;
+
+    friend class DerivedUnitParser;
+    bool addTerm(UnitId unit, int exponent);
+    bool computeDimensions();
+};
+
+// value in to = value in from * factor. The factor is folded from the terms' exact
+// catalogue ratios in double-double, rounded once, and cached per (from, to) pair, so
+// converting repeatedly between the same units costs one multiply. Thread-safe.
+DerivedUnitError derivedFactor(const DerivedUnit& from, const DerivedUnit& to, double& factor);
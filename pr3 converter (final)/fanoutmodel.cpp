@@ -0,0 +1,120 @@
+#include "fanoutmodel.h"
+#include "converter.h"
+
+#include <algorithm>
+#include <cstring>
+
+FanOutModel::FanOutModel(UnitMode mode, QObject *parent)
+    : QAbstractTableModel(parent)
+    , range_(unitRange(mode))
+    , values_(range_.count)
+    , rows_(range_.count)
+{
+}
+
+int FanOutModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(range_.count);
+}
+
+int FanOutModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+QVariant FanOutModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || std::size_t(index.row()) >= range_.count) return {};
+    const std::size_t row = std::size_t(index.row());
+
+    if (index.column() == ValueColumn) {
+        if (role == Qt::DisplayRole)
+            return QString::fromLatin1(rows_[row].text, qsizetype(rows_[row].length));
+        if (role == Qt::TextAlignmentRole)
+            return QVariant::fromValue(Qt::AlignRight | Qt::AlignVCenter);
+        return {};
+    }
+
+    if (role != Qt::DisplayRole) return {};
+    const UnitInfo& u = unitInfo(static_cast<UnitId>(range_.first + row));
+    return QString::fromUtf8(u.name.data(), qsizetype(u.name.size())) + QStringLiteral(" (")
+           + QString::fromUtf8(u.key.data(), qsizetype(u.key.size())) + QLatin1Char(')');
+}
+
+QVariant FanOutModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal || role != Qt::DisplayRole) return {};
+    return section == UnitColumn ? tr("Unit") : tr("Value");
+}
+
+void FanOutModel::setValue(UnitId from, double value)
+{
+    if (Converter::fanOut(from, value, values_) != ConvError::None) {
+        clear();
+        return;
+    }
+    if (rounding_) roundToDecimals(from, value);
+
+    // formatting dominates, and most rows keep their text when only the last digit changes
+    std::size_t runStart = range_.count;
+    for (std::size_t row = 0; row < range_.count; ++row) {
+        char buf[kMaxNumberChars];
+        const char* end = formatNumber(values_[row], buf);
+        if (setRowText(row, buf, std::size_t(end - buf))) {
+            if (runStart == range_.count) runStart = row;
+        } else if (runStart != range_.count) {
+            reportChanged(runStart, row - 1);
+            runStart = range_.count;
+        }
+    }
+    if (runStart != range_.count) reportChanged(runStart, range_.count - 1);
+}
+
+void FanOutModel::clear()
+{
+    std::size_t first = range_.count;
+    std::size_t last = 0;
+    for (std::size_t row = 0; row < range_.count; ++row) {
+        if (setRowText(row, nullptr, 0)) {
+            first = std::min(first, row);
+            last = row;
+        }
+    }
+    if (first != range_.count) reportChanged(first, last);
+}
+
+void FanOutModel::setDecimalRounding(std::optional<DecimalRounding> rounding)
+{
+    rounding_ = rounding;
+    decimals_.clear();
+}
+
+void FanOutModel::roundToDecimals(UnitId from, double value)
+{
+    // one converter per row, kept until the source unit or the rounding changes
+    if (decimals_.empty() || decimalFrom_ != from) {
+        decimals_.clear();
+        decimals_.reserve(range_.count);
+        for (std::size_t row = 0; row < range_.count; ++row)
+            decimals_.emplace_back(from, static_cast<UnitId>(range_.first + row), *rounding_);
+        decimalFrom_ = from;
+    }
+    for (std::size_t row = 0; row < range_.count; ++row) {
+        DecimalValue decimal;
+        if (decimals_[row].convert(value, decimal)) values_[row] = decimal.toDouble();
+    }
+}
+
+bool FanOutModel::setRowText(std::size_t row, const char* text, std::size_t length)
+{
+    RowText& r = rows_[row];
+    if (r.length == length && (length == 0 || std::memcmp(r.text, text, length) == 0)) return false;
+    if (length) std::memcpy(r.text, text, length);
+    r.length = length;
+    return true;
+}
+
+void FanOutModel::reportChanged(std::size_t first, std::size_t last)
+{
+    emit dataChanged(index(int(first), ValueColumn), index(int(last), ValueColumn), { Qt::DisplayRole });
+}
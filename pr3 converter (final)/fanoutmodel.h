@@ -0,0 +1,57 @@
+#ifndef FANOUTMODEL_H
+#define FANOUTMODEL_H
+
+#include <QAbstractTableModel>
+
+#include <optional>
+#include <vector>
+
+#include "decimalconvert.h"
+#include "numbertext.h"
+#include "unitregistry.h"
+
+// One value shown in every unit of a mode. setValue() converts with a single
+// Converter::fanOut pass and formats each row into a fixed buffer; only rows whose text
+// actually changed are reported, so a view repaints just those.
+class FanOutModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column { UnitColumn, ValueColumn, ColumnCount };
+
+    explicit FanOutModel(UnitMode mode, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+    // from must belong to the model's mode.
+    void setValue(UnitId from, double value);
+    // Blanks every value (no valid input).
+    void clear();
+    // Rounds later setValue() results to decimals with DecimalConverter; nullopt shows the
+    // plain double results.
+    void setDecimalRounding(std::optional<DecimalRounding> rounding);
+
+private:
+    struct RowText {
+        char text[kMaxNumberChars];
+        std::size_t length = 0;
+    };
+
+    UnitRange range_;
+    std::vector<double> values_;
+    std::vector<RowText> rows_;
+    std::optional<DecimalRounding> rounding_;
+    std::vector<DecimalConverter> decimals_; // decimalFrom_ to each row's unit, built on first use
+    UnitId decimalFrom_ = UnitId::Invalid;
+
+    // Stores text for row; returns whether it differs from what was shown.
+    bool setRowText(std::size_t row, const char* text, std::size_t length);
+    void reportChanged(std::size_t first, std::size_t last);
+    void roundToDecimals(UnitId from, double value);
+};
+
+#endif // FANOUTMODEL_H
@@ -0,0 +1,146 @@
+#include "filepipeline.h"
+#include "batchkernels.h"
+#include "converter.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QSysInfo>
+
+#include <algorithm>
+#include <string_view>
+#include <utility>
+
+FilePipeline::FilePipeline(FilePipelineConfig config, Report report)
+    : config_(std::move(config))
+    , report_(std::move(report))
+    , read_(config_.queueDepth)
+    , converted_(config_.queueDepth)
+    , convertersLeft_(std::max(config_.convertThreads, 1))
+{
+    threads_.emplace_back([this]{ readStage(); });
+    for (int i = std::max(config_.convertThreads, 1); i > 0; --i)
+        threads_.emplace_back([this]{ convertStage(); });
+    threads_.emplace_back([this]{ writeStage(); });
+}
+
+FilePipeline::~FilePipeline()
+{
+    finish();
+}
+
+void FilePipeline::submit(const QString& path)
+{
+    paths_.push(path);
+}
+
+void FilePipeline::finish()
+{
+    // each stage closes the next queue when its input runs dry
+    paths_.close();
+    for (std::thread& t : threads_) {
+        if (t.joinable()) t.join();
+    }
+}
+
+bool FilePipeline::isOutput(const QString& path) const
+{
+    return QFileInfo(path).completeBaseName().endsWith(QLatin1Char('.') + config_.tag);
+}
+
+bool FilePipeline::accepts(const QString& path) const
+{
+    if (isOutput(path)) return false;
+    const QString suffix = QFileInfo(path).suffix().toLower();
+    if (suffix == QLatin1String("csv")) return !config_.columns.empty();
+    if (suffix == QLatin1String("f64") || suffix == QLatin1String("f32")) return isValidUnit(config_.from);
+    return false;
+}
+
+QString FilePipeline::outputPath(const QString& input) const
+{
+    const QFileInfo info(input);
+    return info.dir().filePath(info.completeBaseName() + QLatin1Char('.') + config_.tag
+                               + QLatin1Char('.') + info.suffix());
+}
+
+void FilePipeline::readStage()
+{
+    QString path;
+    while (paths_.pop(path)) {
+        Job job;
+        job.path = path;
+        const QString suffix = QFileInfo(path).suffix().toLower();
+        job.kind = suffix == QLatin1String("f64") ? FileKind::Float64
+                 : suffix == QLatin1String("f32") ? FileKind::Float32
+                 : FileKind::Csv;
+
+        QFile file(path);
+        if (file.open(QIODevice::ReadOnly)) job.data = file.readAll();
+        if (file.error() != QFileDevice::NoError) job.error = file.errorString();
+        if (!read_.push(std::move(job))) break;
+    }
+    read_.close();
+}
+
+void FilePipeline::convertStage()
+{
+    Job job;
+    while (read_.pop(job)) {
+        if (job.error.isEmpty()) convert(job);
+        if (!converted_.push(std::move(job))) break;
+    }
+    // the last converter out closes the writer's queue
+    if (--convertersLeft_ == 0) converted_.close();
+}
+
+void FilePipeline::convert(Job& job) const
+{
+    if (job.kind == FileKind::Csv) {
+        convertCsvText(std::string_view(job.data.constData(), std::size_t(job.data.size())), job.csvOut,
+                       config_.columns, job.skipped, job.error, config_.format);
+        job.data.clear(); // only csvOut is written
+        return;
+    }
+
+    if (QSysInfo::ByteOrder != QSysInfo::LittleEndian) {
+        job.error = "binary columns need a little-endian host";
+        return;
+    }
+    const qsizetype elemSize = job.kind == FileKind::Float64 ? 8 : 4;
+    if (job.data.size() % elemSize != 0) {
+        job.error = QString("size %1 is not a multiple of %2 bytes").arg(job.data.size()).arg(elemSize);
+        return;
+    }
+    // converted in place; the file was read whole, so data is not shared
+    const Converter::Affine a = Converter::coefficients(config_.from, config_.to);
+    char* bytes = job.data.data();
+    const std::size_t count = std::size_t(job.data.size() / elemSize);
+    if (job.kind == FileKind::Float64)
+        affineBatch(reinterpret_cast<const double*>(bytes), reinterpret_cast<double*>(bytes), count, a.scale, a.offset);
+    else
+        affineBatch(reinterpret_cast<const float*>(bytes), reinterpret_cast<float*>(bytes), count, a.scale, a.offset);
+}
+
+void FilePipeline::writeStage()
+{
+    Job job;
+    while (converted_.pop(job)) {
+        FileResult result;
+        result.input = job.path;
+        result.skipped = job.skipped;
+        result.error = job.error;
+        if (result.error.isEmpty()) {
+            // a temporary file renamed over the output on commit: readers never see a partial file
+            QSaveFile out(outputPath(job.path));
+            const char* data = job.kind == FileKind::Csv ? job.csvOut.data() : job.data.constData();
+            const qint64 size = job.kind == FileKind::Csv ? qint64(job.csvOut.size()) : qint64(job.data.size());
+            if (out.open(QIODevice::WriteOnly) && out.write(data, size) == size && out.commit())
+                result.output = out.fileName();
+            else
+                result.error = out.errorString();
+        }
+        if (report_) report_(result);
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "boundedqueue.h"
+#include "csvconvert.h"
+#include "numbertext.h"
+#include "unitregistry.h"
+
+struct FilePipelineConfig {
+    std::vector<CsvColumn> columns;   // converted in .csv files
+    UnitId from = UnitId::Invalid;    // for .f64 / .f32 columns (raw little-endian values)
+    UnitId to = UnitId::Invalid;
+    NumberFormat format;
+    QString tag = "converted";        // data.csv is written to data.converted.csv
+    std::size_t queueDepth = 16;      // files held between two stages
+    int convertThreads = 1;
+};
+
+struct FileResult {
+    QString input;
+    QString output;     // empty if nothing was written
+    QString error;      // empty on success
+    std::uint64_t skipped = 0; // CSV fields that were not numbers
+};
+
+// Converts whole files in three stages on their own threads: read, convert, and an atomic
+// write (QSaveFile) next to the input. Stages hand files on through BoundedQueues, so
+// reading the next file overlaps converting and writing the previous ones while at most
+// queueDepth files per stage are in memory. Meant for many small files, where starting a
+// process per file would cost more than converting it.
+class FilePipeline
+{
+public:
+    // Called on the writer thread once per submitted file, in completion order.
+    using Report = std::function<void(const FileResult&)>;
+
+    FilePipeline(FilePipelineConfig config, Report report);
+    ~FilePipeline(); // finish()
+
+    // Queues a file; never blocks. The file should be complete (see convertwatch.cpp).
+    void submit(const QString& path);
+    // Converts everything submitted, then stops the threads. No submit() after this.
+    void finish();
+
+    // .csv (when columns are configured), .f64 and .f32 (when from/to are), and not one of
+    // our own outputs.
+    bool accepts(const QString& path) const;
+    QString outputPath(const QString& input) const;
+
+private:
+    enum class FileKind { Csv, Float64, Float32 };
+
+    struct Job {
+        QString path;
+        FileKind kind = FileKind::Csv;
+        QByteArray data;
+        std::string csvOut;
+        std::uint64_t skipped = 0;
+        QString error;
+    };
+
+    const FilePipelineConfig config_;
+    const Report report_;
+
+    BoundedQueue<QString> paths_{ std::numeric_limits<std::size_t>::max() }; // paths are cheap
+    BoundedQueue<Job> read_;
+    BoundedQueue<Job> converted_;
+    std::atomic<int> convertersLeft_;
+    std::vector<std::thread> threads_;
+
+    bool isOutput(const QString& path) const;
+    void readStage();
+    void convertStage();
+    void writeStage();
+    void convert(Job& job) const;
+};
@@ -0,0 +1,476 @@
+#include "jsonconvert.h"
+#include "converter.h"
+
+#include <QByteArray>
+
+#include <bit>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr std::size_t kReadSize = 1 << 20;
+
+struct PathStep {
+    enum class Kind : std::uint8_t { Key, AnyKey, Index, AnyIndex };
+    Kind kind = Kind::AnyKey;
+    std::string key;
+    std::uint64_t index = 0;
+};
+
+using JsonPath = std::vector<PathStep>;
+
+// $ followed by .name, .*, [n], [*], ['name'] or ["name"] steps.
+bool parsePath(std::string_view text, JsonPath& path)
+{
+    path.clear();
+    if (text.empty() || text[0] != '$') return false;
+    std::size_t i = 1;
+    while (i < text.size()) {
+        PathStep step;
+        if (text[i] == '.') {
+            const std::size_t start = ++i;
+            while (i < text.size() && text[i] != '.' && text[i] != '[') ++i;
+            if (i == start) return false; // ".." (recursive descent) is not supported
+            const std::string_view name = text.substr(start, i - start);
+            if (name == "*") step.kind = PathStep::Kind::AnyKey;
+            else step = { PathStep::Kind::Key, std::string(name), 0 };
+        } else if (text[i] == '[') {
+            const std::size_t close = text.find(']', i);
+            if (close == std::string_view::npos) return false;
+            const std::string_view inner = text.substr(i + 1, close - i - 1);
+            i = close + 1;
+            if (inner == "*") {
+                step.kind = PathStep::Kind::AnyIndex;
+            } else if (inner.size() >= 2 && (inner[0] == '\'' || inner[0] == '"') && inner.back() == inner[0]) {
+                step = { PathStep::Kind::Key, std::string(inner.substr(1, inner.size() - 2)), 0 };
+            } else {
+                if (inner.empty()) return false;
+                step.kind = PathStep::Kind::Index;
+                for (const char c : inner) {
+                    if (c < '0' || c > '9') return false;
+                    step.index = step.index * 10 + std::uint64_t(c - '0');
+                }
+            }
+        } else {
+            return false;
+        }
+        path.push_back(std::move(step));
+    }
+    return true;
+}
+
+void appendUtf8(std::string& out, char32_t c)
+{
+    if (c < 0x80) {
+        out += char(c);
+    } else if (c < 0x800) {
+        out += char(0xC0 | (c >> 6));
+        out += char(0x80 | (c & 0x3F));
+    } else if (c < 0x10000) {
+        out += char(0xE0 | (c >> 12));
+        out += char(0x80 | ((c >> 6) & 0x3F));
+        out += char(0x80 | (c & 0x3F));
+    } else {
+        out += char(0xF0 | (c >> 18));
+        out += char(0x80 | ((c >> 12) & 0x3F));
+        out += char(0x80 | ((c >> 6) & 0x3F));
+        out += char(0x80 | (c & 0x3F));
+    }
+}
+
+// The text of a key's escaped JSON string body; bad escapes are kept as written (they can
+// only fail to match).
+std::string unescapeKey(std::string_view raw)
+{
+    std::string key;
+    key.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+        if (raw[i] != '\\' || i + 1 == raw.size()) {
+            key += raw[i];
+            continue;
+        }
+        const char c = raw[++i];
+        switch (c) {
+        case 'b': key += '\b'; break;
+        case 'f': key += '\f'; break;
+        case 'n': key += '\n'; break;
+        case 'r': key += '\r'; break;
+        case 't': key += '\t'; break;
+        case 'u': {
+            const auto hex4 = [&](std::size_t at, char32_t& v) {
+                if (at + 4 > raw.size()) return false;
+                v = 0;
+                for (std::size_t k = at; k < at + 4; ++k) {
+                    const char h = raw[k];
+                    const int d = h >= '0' && h <= '9' ? h - '0' : h >= 'a' && h <= 'f' ? h - 'a' + 10
+                                : h >= 'A' && h <= 'F' ? h - 'A' + 10 : -1;
+                    if (d < 0) return false;
+                    v = v * 16 + char32_t(d);
+                }
+                return true;
+            };
+            char32_t v = 0;
+            if (!hex4(i + 1, v)) {
+                key += "\\u";
+                break;
+            }
+            i += 4;
+            char32_t low = 0;
+            if (v >= 0xD800 && v < 0xDC00 && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u'
+                && hex4(i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                v = 0x10000 + ((v - 0xD800) << 10) + (low - 0xDC00);
+                i += 6;
+            }
+            appendUtf8(key, v);
+            break;
+        }
+        default: key += c; break; // \" \\ \/
+        }
+    }
+    return key;
+}
+
+bool isNumberChar(char c)
+{
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+// Byte-level JSON tokenizer that copies its input to the output, replacing the selected
+// numbers. Strings are streamed (they may span reads); a number or literal cut off at the
+// end of a read is left unconsumed and fed again with the next one.
+class JsonRewriter
+{
+public:
+    JsonRewriter(const std::vector<JsonPath>& paths, const std::vector<Converter::Affine>& affines,
+                 const NumberFormat& format)
+        : paths_(paths), affines_(affines), format_(format)
+        , allPaths_(paths.size() == 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << paths.size()) - 1)
+    {
+    }
+
+    std::uint64_t converted = 0;
+    std::uint64_t skipped = 0;
+    QString error;
+
+    // Rewrites a prefix of [data, data + size) into out and sets consumed to its length;
+    // the rest must be passed again, with more input after it. With eof, everything is
+    // consumed and the input must end between top-level values.
+    bool feed(const char* data, std::size_t size, bool eof, std::string& out, std::size_t& consumed)
+    {
+        const char* p = data;
+        const char* const end = data + size;
+        const char* copyFrom = data;
+        bool ok = true;
+        bool stop = false; // on an error, or a token that continues in the next read
+
+        while (p < end && !stop) {
+            if (inString_) {
+                p = scanString(p, end);
+                continue;
+            }
+            const char c = *p;
+            if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+                ++p;
+                continue;
+            }
+
+            switch (expect_) {
+            case Expect::Value:
+            case Expect::ValueOrEnd:
+                if (c == ']' && expect_ == Expect::ValueOrEnd) {
+                    ++p;
+                    endContainer();
+                } else if (c == '{' || c == '[') {
+                    beginValue();
+                    if (valueTarget_ >= 0) ++skipped;
+                    frames_.push_back({ c == '{', valueMask_, 0 });
+                    expect_ = c == '{' ? Expect::KeyOrEnd : Expect::ValueOrEnd;
+                    ++p;
+                } else if (c == '"') {
+                    beginValue();
+                    if (valueTarget_ >= 0) ++skipped;
+                    inString_ = true;
+                    stringIsKey_ = false;
+                    ++p;
+                } else if (c == '-' || (c >= '0' && c <= '9')) {
+                    const char* e = p;
+                    while (e < end && isNumberChar(*e)) ++e;
+                    if (e == end && !eof) {
+                        stop = true;
+                        break;
+                    }
+                    beginValue();
+                    if (valueTarget_ >= 0) {
+                        out.append(copyFrom, p);
+                        copyFrom = convertNumber(p, e, out) ? e : p;
+                    }
+                    p = e;
+                    afterValue();
+                } else if (c == 't' || c == 'f' || c == 'n') {
+                    const std::string_view word = c == 't' ? "true" : c == 'f' ? "false" : "null";
+                    if (std::size_t(end - p) < word.size() && !eof) {
+                        stop = true;
+                        break;
+                    }
+                    if (std::string_view(p, std::min<std::size_t>(word.size(), std::size_t(end - p))) != word) {
+                        ok = fail(p - data, "unexpected character");
+                        stop = true;
+                        break;
+                    }
+                    beginValue();
+                    if (valueTarget_ >= 0) ++skipped;
+                    p += word.size();
+                    afterValue();
+                } else {
+                    ok = fail(p - data, "expected a value");
+                    stop = true;
+                }
+                break;
+
+            case Expect::KeyOrEnd:
+            case Expect::Key:
+                if (c == '}' && expect_ == Expect::KeyOrEnd) {
+                    ++p;
+                    endContainer();
+                } else if (c == '"') {
+                    inString_ = true;
+                    stringIsKey_ = true;
+                    keyRaw_.clear();
+                    ++p;
+                } else {
+                    ok = fail(p - data, "expected a member name");
+                    stop = true;
+                }
+                break;
+
+            case Expect::Colon:
+                if (c != ':') {
+                    ok = fail(p - data, "expected ':'");
+                    stop = true;
+                    break;
+                }
+                expect_ = Expect::Value;
+                ++p;
+                break;
+
+            case Expect::CommaOrEnd:
+                if (c == ',') {
+                    expect_ = frames_.back().object ? Expect::Key : Expect::Value;
+                    ++p;
+                } else if (c == (frames_.back().object ? '}' : ']')) {
+                    ++p;
+                    endContainer();
+                } else {
+                    ok = fail(p - data, "expected ',' or the end of the object or array");
+                    stop = true;
+                }
+                break;
+            }
+        }
+
+        if (ok && eof && (inString_ || !frames_.empty() || expect_ != Expect::Value))
+            ok = fail(p - data, "unexpected end of input");
+
+        out.append(copyFrom, p);
+        consumed = std::size_t(p - data);
+        offset_ += consumed;
+        return ok;
+    }
+
+private:
+    enum class Expect : std::uint8_t { Value, ValueOrEnd, KeyOrEnd, Key, Colon, CommaOrEnd };
+
+    struct Frame {
+        bool object;
+        std::uint64_t mask;  // paths that still match this container's position
+        std::uint64_t index; // elements or members seen so far
+    };
+
+    const std::vector<JsonPath>& paths_;
+    const std::vector<Converter::Affine>& affines_;
+    const NumberFormat format_;
+    const std::uint64_t allPaths_;
+
+    std::vector<Frame> frames_;
+    Expect expect_ = Expect::Value;
+    bool inString_ = false;
+    bool stringIsKey_ = false;
+    bool escape_ = false;
+    std::string keyRaw_;           // a member name as written, escapes included
+    std::string key_;
+    std::uint64_t memberMask_ = 0; // set by a key for the member value after it
+    std::uint64_t valueMask_ = 0;
+    int valueTarget_ = -1;         // path whose last step selects the current value, or -1
+    std::uint64_t offset_ = 0;     // input bytes consumed by earlier feeds
+
+    bool fail(std::ptrdiff_t at, const char* what)
+    {
+        error = QString("%1 at byte %2").arg(QString::fromUtf8(what)).arg(qulonglong(offset_ + std::uint64_t(at)));
+        return false;
+    }
+
+    // Paths in mask whose step `depth` matches the component (a key, or an array index).
+    std::uint64_t filter(std::uint64_t mask, std::size_t depth, const std::string* key, std::uint64_t index) const
+    {
+        std::uint64_t result = 0;
+        for (; mask; mask &= mask - 1) {
+            const int p = std::countr_zero(mask);
+            const JsonPath& path = paths_[std::size_t(p)];
+            if (depth >= path.size()) continue;
+            const PathStep& step = path[depth];
+            const bool match = key ? (step.kind == PathStep::Kind::AnyKey
+                                      || (step.kind == PathStep::Kind::Key && step.key == *key))
+                                   : (step.kind == PathStep::Kind::AnyIndex
+                                      || (step.kind == PathStep::Kind::Index && step.index == index));
+            if (match) result |= std::uint64_t(1) << p;
+        }
+        return result;
+    }
+
+    void beginValue()
+    {
+        if (frames_.empty()) valueMask_ = allPaths_;
+        else if (frames_.back().object) valueMask_ = memberMask_;
+        else valueMask_ = filter(frames_.back().mask, frames_.size() - 1, nullptr, frames_.back().index);
+
+        valueTarget_ = -1;
+        for (std::uint64_t m = valueMask_; m; m &= m - 1) {
+            const int p = std::countr_zero(m);
+            if (paths_[std::size_t(p)].size() == frames_.size()) {
+                valueTarget_ = p;
+                break;
+            }
+        }
+    }
+
+    void afterValue()
+    {
+        if (frames_.empty()) {
+            expect_ = Expect::Value; // the next document of a sequence
+            return;
+        }
+        ++frames_.back().index;
+        expect_ = Expect::CommaOrEnd;
+    }
+
+    void endContainer()
+    {
+        frames_.pop_back();
+        afterValue();
+    }
+
+    const char* scanString(const char* p, const char* end)
+    {
+        const char* start = p;
+        while (p < end) {
+            if (escape_) {
+                escape_ = false;
+            } else if (*p == '\\') {
+                escape_ = true;
+            } else if (*p == '"') {
+                break;
+            }
+            ++p;
+        }
+        const bool collect = stringIsKey_ && frames_.back().mask != 0;
+        if (collect) keyRaw_.append(start, p);
+        if (p == end) return p;
+
+        inString_ = false;
+        if (stringIsKey_) {
+            memberMask_ = collect ? filter(frames_.back().mask, frames_.size() - 1, &unescaped(), 0) : 0;
+            expect_ = Expect::Colon;
+        } else {
+            afterValue();
+        }
+        return p + 1;
+    }
+
+    const std::string& unescaped()
+    {
+        key_ = keyRaw_.find('\\') == std::string::npos ? keyRaw_ : unescapeKey(keyRaw_);
+        return key_;
+    }
+
+    bool convertNumber(const char* b, const char* e, std::string& out)
+    {
+        double v = 0.0;
+        if (!parseNumber(b, e, v)) {
+            ++skipped;
+            return false;
+        }
+        const double r = affines_[std::size_t(valueTarget_)].apply(v);
+        if (!std::isfinite(r)) {
+            ++skipped;
+            return false;
+        }
+        char buf[kMaxNumberChars];
+        out.append(buf, formatNumber(r, buf, format_));
+        ++converted;
+        return true;
+    }
+};
+
+} // namespace
+
+bool convertJsonStream(std::FILE* in, std::FILE* out, const std::vector<JsonField>& fields,
+                       std::uint64_t& converted, std::uint64_t& skipped, QString& error,
+                       const NumberFormat& format)
+{
+    converted = 0;
+    skipped = 0;
+    if (fields.empty() || fields.size() > kMaxJsonFields) {
+        error = QString("between 1 and %1 fields can be converted").arg(qulonglong(kMaxJsonFields));
+        return false;
+    }
+
+    std::vector<JsonPath> paths(fields.size());
+    std::vector<Converter::Affine> affines;
+    affines.reserve(fields.size());
+    for (std::size_t i = 0; i < fields.size(); ++i) {
+        const QByteArray path = fields[i].path.toUtf8();
+        if (!parsePath(std::string_view(path.constData(), std::size_t(path.size())), paths[i])) {
+            error = QString("bad path '%1'").arg(fields[i].path);
+            return false;
+        }
+        affines.push_back(Converter::coefficients(fields[i].from, fields[i].to));
+    }
+
+    JsonRewriter rewriter(paths, affines, format);
+    std::string buf;
+    std::string rewritten;
+    bool eof = false;
+    while (!eof) {
+        const std::size_t old = buf.size();
+        buf.resize(old + kReadSize);
+        const std::size_t n = std::fread(buf.data() + old, 1, kReadSize, in);
+        buf.resize(old + n);
+        if (n == 0) {
+            if (std::ferror(in)) {
+                error = "read failed";
+                return false;
+            }
+            eof = true;
+        }
+
+        std::size_t consumed = 0;
+        const bool ok = rewriter.feed(buf.data(), buf.size(), eof, rewritten, consumed);
+        if (std::fwrite(rewritten.data(), 1, rewritten.size(), out) != rewritten.size()) {
+            error = "write failed";
+            return false;
+        }
+        rewritten.clear();
+        buf.erase(0, consumed);
+        if (!ok) {
+            error = rewriter.error;
+            converted = rewriter.converted;
+            skipped = rewriter.skipped;
+            return false;
+        }
+    }
+    converted = rewriter.converted;
+    skipped = rewriter.skipped;
+    return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <QString>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "numbertext.h"
+#include "unitregistry.h"
+
+struct JsonField {
+    QString path;
+    UnitId from = UnitId::Invalid;
+    UnitId to = UnitId::Invalid;
+};
+
+// Most fields one convertJsonStream call can select.
+inline constexpr std::size_t kMaxJsonFields = 64;
+
+// Converts the numbers at the given paths of a JSON document, or of a sequence of them such
+// as NDJSON; every other byte, whitespace and formatting included, is copied through. The
+// input is tokenized in one streaming pass with only the open objects and arrays kept, so
+// memory does not grow with the document.
+//
+// Paths are written $.readings[*].temp_f: from the root $, .name or ['name'] selects an
+// object member, [n] an array element, and * (.* or [*]) any member or element. Each path
+// applies to every top-level value. Values at a selected path that are not numbers (strings,
+// null, objects) are left as they are and counted in skipped; converted counts the rewritten
+// numbers. On malformed input, error names the byte offset.
+bool convertJsonStream(std::FILE* in, std::FILE* out, const std::vector<JsonField>& fields,
+                       std::uint64_t& converted, std::uint64_t& skipped, QString& error,
+                       const NumberFormat& format = {});
@@ -1,11 +1,52 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
+#include "bulkconvertpage.h"
 #include "converter.h"
-
-#include <QDoubleValidator>
+#include "decimalconvert.h"
+#include "fanoutmodel.h"
+#include "numbertext.h"
+#include "timestamp.h"
+#include "timestamppage.h"
+#include "unitexpr.h"
+#include "unitlistmodel.h"
+#ifdef CONVERTER_ALLOC_TRACE
+#include "alloccounter.h"
+#include <QDebug>
+#endif
+
+#include <QAction>
+#include <QActionGroup>
+#include <QBoxLayout>
+#include <QCheckBox>
+#include <QHeaderView>
+#include <QLoggingCategory>
+#include <QMenu>
+#include <QMenuBar>
+#include <QScreen>
 #include <QSignalBlocker>
+#include <QStatusBar>
+#include <QStyle>
 #include <QLocale>
-#include <QDebug>
+#include <QTableView>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Input-to-update timing; off unless enabled with QT_LOGGING_RULES="converter.latency.debug=true"
+// or View > Time Input Latency.
+Q_LOGGING_CATEGORY(lcLatency, "converter.latency", QtWarningMsg)
+
+// View > Decimal Precision; the first is the default.
+static constexpr DecimalRounding kDecimalPrecisions[] = {
+    { DecimalRounding::Style::Significant, 15 },
+    { DecimalRounding::Style::Significant, 12 },
+    { DecimalRounding::Style::Significant, 9 },
+    { DecimalRounding::Style::Significant, 6 },
+    { DecimalRounding::Style::Fixed, 2 },
+    { DecimalRounding::Style::Fixed, 4 },
+    { DecimalRounding::Style::Fixed, 6 },
+};
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -13,10 +54,34 @@ MainWindow::MainWindow(QWidget *parent)
 {
     ui->setupUi(this);
 
-    setupBindings();
-    applyValidators();
+    // error state is a dynamic property, so toggling it never swaps style sheets
+    setStyleSheet(QStringLiteral("QLineEdit[invalid=\"true\"] { border: 1px solid #d9534f; }"));
+
+    recalcTimer_.setSingleShot(true);
+    recalcTimer_.setTimerType(Qt::PreciseTimer);
+    connect(&recalcTimer_, &QTimer::timeout, this, &MainWindow::runPendingRecalcs);
+
+    QMenu* viewMenu = ui->menubar->addMenu(tr("&View"));
+    QAction* latencyAction = viewMenu->addAction(tr("Time Input &Latency"));
+    latencyAction->setCheckable(true);
+    latencyAction->setShortcut(QKeySequence(Qt::CTRL | Qt::SHIFT | Qt::Key_L));
+    latencyAction->setChecked(lcLatency().isDebugEnabled());
+    timeLatency_ = latencyAction->isChecked();
+    connect(latencyAction, &QAction::toggled, this, [this](bool on){
+        timeLatency_ = on;
+        pendingEdits_ = 0;
+        if (!on) ui->statusbar->clearMessage();
+    });
+    setupDecimalMenu(viewMenu);
 
-    recalcUsingLastSource(ui->tabWidget->currentIndex());
+    setupTabs();
+
+    connect(ui->quickEdit, &QLineEdit::textChanged, this, &MainWindow::updateQuickConvert);
+    connect(ui->quickEdit, &QLineEdit::returnPressed, this, &MainWindow::applyQuickConvert);
+
+    const int current = ui->tabWidget->currentIndex();
+    ensureTab(current);
+    recalcUsingLastSource(current);
 }
 
 MainWindow::~MainWindow()
@@ -24,133 +89,304 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-void MainWindow::setupBindings()
+void MainWindow::setupTabs()
 {
-    for (int i = 0; i < 3; ++i) bindTab(i);
+    // One tab per registry mode; only the (empty) page exists until the tab is shown.
+    tabs_.resize(kModeCount);
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        TabBinding& t = tabs_[m];
+        t.mode = static_cast<UnitMode>(m);
+        t.page = new QWidget;
+        const std::string_view title = unitModeName(t.mode);
+        ui->tabWidget->addTab(t.page, QString::fromUtf8(title.data(), qsizetype(title.size())));
+    }
+    // after the mode tabs, so tab index == mode index still holds for tabs_
+    bulkTab_ = new QWidget;
+    ui->tabWidget->addTab(bulkTab_, tr("Bulk"));
+    timeZoneTab_ = new QWidget;
+    ui->tabWidget->addTab(timeZoneTab_, tr("Time Zones"));
 
     connect(ui->tabWidget, &QTabWidget::currentChanged, this, [this](int idx){
+        ensureTab(idx);
         recalcUsingLastSource(idx);
     });
 }
 
-static QStringList prefixCandidatesForTab(int tabIndex)
+void MainWindow::ensureTab(int tabIndex)
 {
-    if (tabIndex == 0) return {"Length"};
-    if (tabIndex == 1) return {"Mass"};
-    return {"Temp", "Temperature"};
-}
-
-void MainWindow::bindTab(int tabIndex)
-{
-    TabBinding& t = tabs_[tabIndex];
-    t.page = ui->tabWidget->widget(tabIndex);
-
-    auto tryBind = [&](const QString& prefix) -> bool {
-        const QString topEditName    = "edit"  + prefix + "Top";
-        const QString bottomEditName = "edit"  + prefix + "Bottom";
-        const QString topUnitName    = "combo" + prefix + "TopUnit";
-        const QString bottomUnitName = "combo" + prefix + "BottomUnit";
-
-        t.topEdit    = t.page->findChild<QLineEdit*>(topEditName);
-        t.bottomEdit = t.page->findChild<QLineEdit*>(bottomEditName);
-        t.topUnit    = t.page->findChild<QComboBox*>(topUnitName);
-        t.bottomUnit = t.page->findChild<QComboBox*>(bottomUnitName);
-
-        if (t.topEdit && t.bottomEdit && t.topUnit && t.bottomUnit)
-            return true;
-
-        const QString topUnitName2    = "combo" + prefix + "Top";
-        const QString bottomUnitName2 = "combo" + prefix + "Bottom";
-
-        if (!t.topUnit)    t.topUnit    = t.page->findChild<QComboBox*>(topUnitName2);
-        if (!t.bottomUnit) t.bottomUnit = t.page->findChild<QComboBox*>(bottomUnitName2);
-
-        return (t.topEdit && t.bottomEdit && t.topUnit && t.bottomUnit);
-    };
-
-    QStringList prefixes;
-    if (tabIndex == 0) prefixes = {"Length"};
-    else if (tabIndex == 1) prefixes = {"Mass"};
-    else prefixes = {"Temp", "Temperature"};
-
-    bool ok = false;
-    QString usedPrefix;
-
-    for (int i = 0; i < prefixes.size(); ++i) {
-        const QString& p = prefixes.at(i);
-        t.topEdit = nullptr;
-        t.bottomEdit = nullptr;
-        t.topUnit = nullptr;
-        t.bottomUnit = nullptr;
-
-        if (tryBind(p)) {
-            ok = true;
-            usedPrefix = p;
-            break;
-        }
-    }
-
-    if (!ok) {
-        qDebug() << "Bind FAILED for tab" << tabIndex
-                 << "Tried prefixes:" << prefixes
-                 << "Page objectName:" << t.page->objectName();
+    if (tabIndex < 0) return;
+    if (std::size_t(tabIndex) >= tabs_.size()) {
+        ensureToolTab(ui->tabWidget->widget(tabIndex));
         return;
     }
+    TabBinding& t = tabs_[std::size_t(tabIndex)];
+    if (t.units) return;
+
+    // both combos of a tab share one model of the mode's units
+    t.units = new UnitListModel(t.mode, t.page);
+    t.topEdit = new QLineEdit(t.page);
+    t.topUnit = new QComboBox(t.page);
+    t.bottomEdit = new QLineEdit(t.page);
+    t.bottomUnit = new QComboBox(t.page);
+
+    auto* rows = new QVBoxLayout;
+    rows->setSpacing(23);
+    for (const auto& [edit, combo] : { std::pair(t.topEdit, t.topUnit), std::pair(t.bottomEdit, t.bottomUnit) }) {
+        edit->setMinimumSize(271, 40);
+        combo->setMinimumSize(180, 40);
+        combo->setModel(t.units);
+
+        auto* row = new QHBoxLayout;
+        row->addWidget(edit);
+        row->addWidget(combo);
+        rows->addLayout(row);
+    }
+    // the all-units table and its model are only built when first asked for
+    t.allUnits = new QCheckBox(tr("Show all units"), t.page);
+    auto* pageLayout = new QVBoxLayout(t.page);
+    pageLayout->addLayout(rows);
+    pageLayout->addWidget(t.allUnits);
 
-    qDebug() << "bindTab OK tabIndex=" << tabIndex
-             << "usedPrefix=" << usedPrefix
-             << "topEdit=" << t.topEdit->objectName()
-             << "bottomEdit=" << t.bottomEdit->objectName()
-             << "topUnit=" << t.topUnit->objectName()
-             << "bottomUnit=" << t.bottomUnit->objectName();
+    if (t.units->rowCount() > 1) t.bottomUnit->setCurrentIndex(1);
 
     connect(t.topEdit, &QLineEdit::textChanged, this, [this, tabIndex](const QString&){
-        tabs_[tabIndex].lastEdited = SourceField::Top;
-        recalc(tabIndex, SourceField::Top);
+        tabs_[std::size_t(tabIndex)].lastEdited = SourceField::Top;
+        requestRecalc(tabIndex);
     });
 
     connect(t.bottomEdit, &QLineEdit::textChanged, this, [this, tabIndex](const QString&){
-        tabs_[tabIndex].lastEdited = SourceField::Bottom;
-        recalc(tabIndex, SourceField::Bottom);
+        tabs_[std::size_t(tabIndex)].lastEdited = SourceField::Bottom;
+        requestRecalc(tabIndex);
     });
 
+    connect(t.allUnits, &QCheckBox::toggled, this, [this, tabIndex](bool on){
+        showAllUnits(tabIndex, on);
+    });
+
+    // wheel-scrolling a combo changes units as fast as typing does
     auto unitChanged = [this, tabIndex]{
-        recalcUsingLastSource(tabIndex);
+        requestRecalc(tabIndex);
     };
 
     connect(t.topUnit, QOverload<int>::of(&QComboBox::currentIndexChanged), this, unitChanged);
     connect(t.bottomUnit, QOverload<int>::of(&QComboBox::currentIndexChanged), this, unitChanged);
 }
 
-void MainWindow::applyValidators()
+void MainWindow::ensureToolTab(QWidget* tab)
 {
-    for (int i = 0; i < 3; ++i) {
-        if (!tabs_[i].topEdit || !tabs_[i].bottomEdit) {
-            qDebug() << "applyValidators skipped tab" << i << "(bindings missing)";
-            continue;
-        }
+    QWidget* page = nullptr;
+    if (tab == bulkTab_ && !bulkPage_) {
+        bulkPage_ = new BulkConvertPage;
+        bulkPage_->setDecimalRounding(decimalRounding_);
+        page = bulkPage_;
+    } else if (tab == timeZoneTab_ && !timeZonePageBuilt_) {
+        timeZonePageBuilt_ = true;
+        page = new TimestampPage;
+    }
+    if (!page) return;
+
+    auto* layout = new QVBoxLayout(tab);
+    layout->setContentsMargins(0, 0, 0, 0);
+    layout->addWidget(page);
+}
+
+// Exact Decimals is off by default: 15 significant digits are too few for some results
+// (Unix microseconds need 16), and the rounding's rare exact fallback allocates, which the
+// keystroke path otherwise never does. Picking a precision turns it on.
+void MainWindow::setupDecimalMenu(QMenu* viewMenu)
+{
+    viewMenu->addSeparator();
+    QAction* exactAction = viewMenu->addAction(tr("&Exact Decimals"));
+    exactAction->setCheckable(true);
+    exactAction->setToolTip(tr("Round results to decimals: 37 C shows as 98.6 F, not 98.60000000000001"));
+    QMenu* precisionMenu = viewMenu->addMenu(tr("Decimal &Precision"));
+    auto* precisions = new QActionGroup(this);
+
+    for (std::size_t i = 0; i < std::size(kDecimalPrecisions); ++i) {
+        const DecimalRounding& r = kDecimalPrecisions[i];
+        const QString label = r.style == DecimalRounding::Style::Significant
+                                  ? tr("%n significant digit(s)", nullptr, r.digits)
+                                  : tr("%n decimal place(s)", nullptr, r.digits);
+        QAction* action = precisionMenu->addAction(label);
+        action->setCheckable(true);
+        action->setChecked(i == 0);
+        action->setData(int(i));
+        precisions->addAction(action);
+    }
+
+    auto apply = [this, exactAction, precisions]{
+        const QAction* checked = precisions->checkedAction();
+        const DecimalRounding& r = kDecimalPrecisions[checked ? checked->data().toInt() : 0];
+        setDecimalRounding(exactAction->isChecked() ? std::optional(r) : std::nullopt);
+    };
+    connect(exactAction, &QAction::toggled, this, apply);
+    connect(precisions, &QActionGroup::triggered, this, [exactAction, apply]{
+        const QSignalBlocker b(exactAction);
+        exactAction->setChecked(true);
+        apply();
+    });
+}
+
+void MainWindow::setDecimalRounding(std::optional<DecimalRounding> rounding)
+{
+    decimalRounding_ = rounding;
+    for (TabBinding& t : tabs_) {
+        t.decimal.reset();
+        if (t.fanOut) t.fanOut->setDecimalRounding(rounding);
+    }
+    if (bulkPage_) bulkPage_->setDecimalRounding(rounding);
+    recalcUsingLastSource(ui->tabWidget->currentIndex());
+}
 
-        auto* v1 = new QDoubleValidator(this);
-        v1->setNotation(QDoubleValidator::StandardNotation);
+static QString unitText(std::string_view s)
+{
+    return QString::fromUtf8(s.data(), qsizetype(s.size()));
+}
 
-        auto* v2 = new QDoubleValidator(this);
-        v2->setNotation(QDoubleValidator::StandardNotation);
+void MainWindow::updateQuickConvert()
+{
+    const QByteArray text = ui->quickEdit->text().toUtf8();
+    const QuickConvertError e = quickConvert(std::string_view(text.constData(), std::size_t(text.size())), quick_);
+    quickValid_ = e == QuickConvertError::None;
+
+    QString message;
+    switch (e) {
+    case QuickConvertError::None: {
+        char buf[kMaxNumberChars];
+        message = QStringLiteral("= ") + formatNumber(quick_.result, buf) + QLatin1Char(' ')
+                  + unitText(unitInfo(quick_.to).key);
+        break;
+    }
+    case QuickConvertError::Empty:
+        break;
+    case QuickConvertError::NoNumber:
+        message = tr("Start with a number");
+        break;
+    case QuickConvertError::NoUnit:
+    case QuickConvertError::UnknownUnit:
+        message = tr("Unknown unit");
+        break;
+    case QuickConvertError::NoTarget:
+        message = tr("%1: add \"in <unit>\"").arg(unitText(unitInfo(quick_.from).name));
+        break;
+    case QuickConvertError::UnknownTarget:
+        message = tr("No %1 unit matches").arg(unitText(unitModeName(unitInfo(quick_.from).mode)).toLower());
+        break;
+    case QuickConvertError::ModeMismatch:
+        message = tr("Cannot convert %1 to %2").arg(unitText(unitInfo(quick_.from).name),
+                                                    unitText(unitInfo(quick_.to).name));
+        break;
+    }
+    ui->quickResult->setText(message);
+}
 
-        tabs_[i].topEdit->setValidator(v1);
-        tabs_[i].bottomEdit->setValidator(v2);
+// Enter in the quick-convert box carries the conversion over to its mode's tab.
+void MainWindow::applyQuickConvert()
+{
+    if (!quickValid_) return;
+
+    const UnitMode mode = unitInfo(quick_.from).mode;
+    const int tabIndex = int(mode);
+    ensureTab(tabIndex);
+    ui->tabWidget->setCurrentIndex(tabIndex);
+
+    TabBinding& t = tabs_[std::size_t(tabIndex)];
+    const std::size_t first = unitRange(mode).first;
+    {
+        // one recalc below instead of one per combo change
+        QSignalBlocker bt(t.topUnit);
+        QSignalBlocker bb(t.bottomUnit);
+        t.topUnit->setCurrentIndex(int(std::size_t(quick_.from) - first));
+        t.bottomUnit->setCurrentIndex(int(std::size_t(quick_.to) - first));
     }
+    char buf[kMaxNumberChars];
+    const QString value(formatNumber(quick_.value, buf));
+    t.lastEdited = SourceField::Top;
+    if (t.topEdit->text() != value) t.topEdit->setText(value);
+    else recalc(tabIndex, SourceField::Top);
+}
+
+void MainWindow::showAllUnits(int tabIndex, bool show)
+{
+    TabBinding& t = tabs_[std::size_t(tabIndex)];
+    if (show && !t.allView) {
+        t.fanOut = new FanOutModel(t.mode, t.page);
+        t.fanOut->setDecimalRounding(decimalRounding_);
+        t.allView = new QTableView(t.page);
+        t.allView->setModel(t.fanOut);
+        t.allView->verticalHeader()->hide();
+        t.allView->horizontalHeader()->setSectionResizeMode(FanOutModel::UnitColumn, QHeaderView::Stretch);
+        t.allView->horizontalHeader()->setSectionResizeMode(FanOutModel::ValueColumn, QHeaderView::Stretch);
+        // uniform rows, so the view never measures every row's text
+        t.allView->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+        t.page->layout()->addWidget(t.allView);
+    }
+    if (!t.allView) return;
+
+    t.allView->setVisible(show);
+    if (show) recalcUsingLastSource(tabIndex);
+}
+
+// Edits only mark their tab; the recalc runs at the next frame boundary, so a burst of
+// keystrokes (or a paste that fires several textChanged) costs one recalc per frame.
+void MainWindow::requestRecalc(int tabIndex)
+{
+    tabs_[std::size_t(tabIndex)].recalcPending = true;
+    if (timeLatency_ && pendingEdits_++ == 0) inputClock_.start();
+    if (recalcTimer_.isActive()) return;
+
+    const qint64 frameMs = frameIntervalMs();
+    const qint64 sinceLast = lastRecalc_.isValid() ? lastRecalc_.elapsed() : frameMs;
+    recalcTimer_.start(int(std::max<qint64>(0, frameMs - sinceLast)));
+}
+
+void MainWindow::runPendingRecalcs()
+{
+    for (std::size_t i = 0; i < tabs_.size(); ++i) {
+        if (!tabs_[i].recalcPending) continue;
+        tabs_[i].recalcPending = false;
+        recalc(int(i), tabs_[i].lastEdited);
+    }
+    lastRecalc_.start();
+
+    if (timeLatency_ && pendingEdits_ > 0) {
+        const double ms = double(inputClock_.nsecsElapsed()) * 1e-6;
+        const QString message = tr("Input to update: %1 ms (%n edit(s))", nullptr, pendingEdits_)
+                                    .arg(ms, 0, 'f', 2);
+        ui->statusbar->showMessage(message);
+        qCDebug(lcLatency).noquote() << message;
+        pendingEdits_ = 0;
+    }
+}
+
+qint64 MainWindow::frameIntervalMs() const
+{
+    const QScreen* s = screen();
+    const qreal hz = s ? s->refreshRate() : 60.0;
+    return qint64(std::lround(1000.0 / (hz > 1.0 ? hz : 60.0)));
 }
 
 void MainWindow::recalcUsingLastSource(int tabIndex)
 {
-    if (tabIndex < 0 || tabIndex > 2) return;
-    recalc(tabIndex, tabs_[tabIndex].lastEdited);
+    if (tabIndex < 0 || std::size_t(tabIndex) >= tabs_.size()) return;
+    recalc(tabIndex, tabs_[std::size_t(tabIndex)].lastEdited);
 }
 
 void MainWindow::recalc(int tabIndex, SourceField source)
 {
-    TabBinding& t = tabs_[tabIndex];
-    if (!t.topEdit || !t.bottomEdit || !t.topUnit || !t.bottomUnit) return;
+#ifdef CONVERTER_ALLOC_TRACE
+    struct AllocReport {
+        const std::uint64_t before = allocationCount();
+        ~AllocReport()
+        {
+            const std::uint64_t n = allocationCount() - before;
+            qDebug() << "recalc allocations:" << n;
+        }
+    } allocReport;
+#endif
+
+    TabBinding& t = tabs_[std::size_t(tabIndex)];
+    if (!t.units) return;
 
     QLineEdit* srcEdit = (source == SourceField::Top) ? t.topEdit : t.bottomEdit;
     QLineEdit* dstEdit = (source == SourceField::Top) ? t.bottomEdit : t.topEdit;
@@ -158,73 +394,122 @@ void MainWindow::recalc(int tabIndex, SourceField source)
     QComboBox* srcUnit = (source == SourceField::Top) ? t.topUnit : t.bottomUnit;
     QComboBox* dstUnit = (source == SourceField::Top) ? t.bottomUnit : t.topUnit;
 
-    const QString text = srcEdit->text().trimmed();
-    if (text.isEmpty()) {
+    // text() shares the line edit's buffer; trimming a view copies nothing
+    const QString text = srcEdit->text();
+    const QStringView trimmed = QStringView(text).trimmed();
+    if (trimmed.isEmpty()) {
         setError(srcEdit, false);
+        if (t.fanOut) t.fanOut->clear();
         return;
     }
 
+    const UnitId fromU = t.units->unitAt(srcUnit->currentIndex());
+    const UnitId toU   = t.units->unitAt(dstUnit->currentIndex());
+
+    // a plain number stays on the allocation-free path; anything else is an expression
     double value = 0.0;
-    if (!tryParseDouble(text, value)) {
+    if (!tryParseDouble(trimmed, value) && !evaluateExpression(trimmed, fromU, value)) {
         setError(srcEdit, true);
+        if (t.fanOut) t.fanOut->clear();
         return;
     }
     setError(srcEdit, false);
 
-    Converter::Mode mode = Converter::Mode::Length;
-    if (tabIndex == 1) mode = Converter::Mode::Mass;
-    if (tabIndex == 2) mode = Converter::Mode::Temperature;
-
-    const QString fromU = unitKeyFromCombo(srcUnit);
-    const QString toU   = unitKeyFromCombo(dstUnit);
+    // every unit at once: one vectorized pass, repainting only rows whose text changed
+    if (t.allView && t.allView->isVisible()) t.fanOut->setValue(fromU, value);
 
     double result = 0.0;
-    try {
-        result = Converter::convert(mode, value, fromU, toU);
-    } catch (...) {
+    if (Converter::tryConvert(fromU, toU, value, result) != ConvError::None)
         return;
+    if (decimalRounding_) {
+        // 37 C reads 98.6 F, not 98.60000000000001; the converter is built once per unit pair
+        if (!t.decimal || t.decimal->from() != fromU || t.decimal->to() != toU)
+            t.decimal.emplace(fromU, toU, *decimalRounding_);
+        DecimalValue decimal;
+        if (t.decimal->convert(value, decimal)) result = decimal.toDouble();
     }
 
-    const QString outText = formatNumber(result);
+    char buf[std::max(kMaxNumberChars, kMaxTimestampChars)];
+    QLatin1StringView outText;
+    if (!convertUnixTime(trimmed, fromU, toU, buf, outText)) outText = formatNumber(result, buf);
 
-    QSignalBlocker b(dstEdit);
-    dstEdit->setText(outText);
+    // the only allocation left is the line edit's own copy, and only when the text changes
+    if (dstEdit->text() != outText) {
+        QSignalBlocker b(dstEdit);
+        dstEdit->setText(QString(outText));
+    }
 }
 
-bool MainWindow::tryParseDouble(const QString& text, double& out)
+bool MainWindow::tryParseDouble(QStringView text, double& out)
 {
-    QString s = text.trimmed();
-    if (s.contains(',')) s.replace(',', '.');
+    // Numbers are ASCII, so narrow into a stack buffer (',' accepted as the decimal point)
+    // and hand that to std::from_chars; longer input takes the allocating QLocale route.
+    char buf[128];
+    text = text.trimmed();
+    if (text.size() > qsizetype(sizeof(buf))) {
+        QString s = text.toString();
+        s.replace(',', '.');
+        bool ok = false;
+        out = QLocale::c().toDouble(s, &ok);
+        return ok;
+    }
 
-    bool ok = false;
-    out = QLocale::c().toDouble(s, &ok);
-    return ok;
+    qsizetype n = 0;
+    for (const QChar c : text) {
+        const char16_t u = c.unicode();
+        if (u > 0x7f) return false;
+        buf[n++] = (u == ',') ? '.' : char(u);
+    }
+    return parseNumber(buf, buf + n, out);
 }
 
-QString MainWindow::unitKeyFromCombo(QComboBox* combo)
+bool MainWindow::evaluateExpression(QStringView text, UnitId unit, double& out)
 {
-    const QVariant d = combo->currentData();
-    if (d.isValid() && !d.toString().isEmpty())
-        return d.toString();
+    // "5 ft 3 in", "2 * 3.5 m": the value in `unit`; a plain number is taken to be in it already
+    const QByteArray utf8 = text.toUtf8();
+    ExprError error = ExprError::None;
+    const auto expr = UnitExpression::compileCached(std::string_view(utf8.constData(), std::size_t(utf8.size())), error);
+    if (!expr || expr->usesInput()) return false;
+
+    const double none = 0.0;
+    return Converter::evaluateBatch(*expr, unit, std::span(&none, 1), std::span(&out, 1)) == ConvError::None;
+}
 
-    const QString t = combo->currentText();
-    int l = t.lastIndexOf('(');
-    int r = t.lastIndexOf(')');
-    if (l != -1 && r != -1 && r > l + 1) {
-        QString key = t.mid(l + 1, r - l - 1).trimmed();
-        key.remove(QChar(0x00B0));
-        return key;
+bool MainWindow::convertUnixTime(QStringView text, UnitId from, UnitId to, char* buf, QLatin1StringView& out)
+{
+    // Unix counts go exactly through seconds and nanoseconds; as a double, a present-day
+    // unix_ns value is off by up to 128 ns. Anything else (an expression, a Julian date)
+    // takes the double result.
+    TimestampStyle fromStyle;
+    TimestampStyle toStyle;
+    if (!timestampStyleForUnit(from, fromStyle) || !timestampStyleForUnit(to, toStyle)) return false;
+
+    char in[64];
+    if (text.size() > qsizetype(sizeof(in))) return false;
+    qsizetype n = 0;
+    for (const QChar c : text) {
+        const char16_t u = c.unicode();
+        if (u > 0x7f) return false;
+        in[n++] = (u == ',') ? '.' : char(u);
     }
-    return t.trimmed();
+    TimeZone::Cursor utc(TimeZone::utc());
+    Instant t;
+    if (!parseTimestamp(in, in + n, fromStyle, utc, t)) return false;
+    out = QLatin1StringView(buf, formatTimestamp(t, toStyle, utc, buf) - buf);
+    return true;
 }
 
-QString MainWindow::formatNumber(double v)
+QLatin1StringView MainWindow::formatNumber(double v, char* buf)
 {
-    return QString::number(v, 'g', 10);
+    // shortest text that parses back to v, so copying a result never changes it
+    return QLatin1StringView(buf, ::formatNumber(v, buf) - buf);
 }
 
 void MainWindow::setError(QLineEdit* edit, bool isError)
 {
-    if (isError) edit->setStyleSheet("border: 1px solid #d9534f;");
-    else edit->setStyleSheet("");
+    // called on every recalc; only an actual change re-polishes the widget
+    if (edit->property("invalid").toBool() == isError) return;
+    edit->setProperty("invalid", isError);
+    edit->style()->unpolish(edit);
+    edit->style()->polish(edit);
 }
@@ -4,8 +4,24 @@
 #include <QMainWindow>
 #include <QLineEdit>
 #include <QComboBox>
+#include <QElapsedTimer>
+#include <QTimer>
 #include <QWidget>
 
+#include <optional>
+#include <vector>
+
+#include "converter.h"
+#include "decimalconvert.h"
+#include "quickconvert.h"
+
+class BulkConvertPage;
+class FanOutModel;
+class QCheckBox;
+class QMenu;
+class QTableView;
+class UnitListModel;
+
 QT_BEGIN_NAMESPACE
 namespace Ui {
 class MainWindow;
@@ -24,26 +40,63 @@ private:
     Ui::MainWindow *ui;
     enum class SourceField { Top, Bottom };
 
+    // One per registry mode. The page is an empty placeholder until the tab is first shown;
+    // ensureTab then builds its widgets and keeps direct pointers to them.
     struct TabBinding {
+        UnitMode mode = UnitMode::Length;
         QWidget* page = nullptr;
+        UnitListModel* units = nullptr; // null until the tab is built
         QLineEdit* topEdit = nullptr;
         QComboBox* topUnit = nullptr;
         QLineEdit* bottomEdit = nullptr;
         QComboBox* bottomUnit = nullptr;
         SourceField lastEdited = SourceField::Top;
+        bool recalcPending = false;
+        QCheckBox* allUnits = nullptr;
+        QTableView* allView = nullptr;   // null until "Show all units" is first checked
+        FanOutModel* fanOut = nullptr;
+        std::optional<DecimalConverter> decimal; // last unit pair converted with decimalRounding_
     };
 
-    TabBinding tabs_[3];
+    std::vector<TabBinding> tabs_;
+
+    QTimer recalcTimer_;          // coalesces edits: at most one recalc per frame
+    QElapsedTimer lastRecalc_;
+    QElapsedTimer inputClock_;    // since the first edit of the pending batch
+    int pendingEdits_ = 0;
+    bool timeLatency_ = false;
+
+    // View > Exact Decimals: results rounded to this decimal precision; nullopt shows doubles
+    std::optional<DecimalRounding> decimalRounding_;
+
+    // The Bulk and Time Zones tabs, after the mode tabs: placeholders until first shown, like
+    // the mode tabs' pages.
+    QWidget* bulkTab_ = nullptr;
+    BulkConvertPage* bulkPage_ = nullptr;
+    QWidget* timeZoneTab_ = nullptr;
+    bool timeZonePageBuilt_ = false;
+
+    QuickConversion quick_;
+    bool quickValid_ = false;
 
-    void setupBindings();
-    void bindTab(int tabIndex);
-    void applyValidators();
+    void setupTabs();
+    void ensureTab(int tabIndex);
+    void ensureToolTab(QWidget* tab);
+    void updateQuickConvert();
+    void applyQuickConvert();
     void recalc(int tabIndex, SourceField source);
     void recalcUsingLastSource(int tabIndex);
+    void requestRecalc(int tabIndex);
+    void runPendingRecalcs();
+    qint64 frameIntervalMs() const;
+    void showAllUnits(int tabIndex, bool show);
+    void setupDecimalMenu(QMenu* viewMenu);
+    void setDecimalRounding(std::optional<DecimalRounding> rounding);
 
-    static bool tryParseDouble(const QString& text, double& out);
-    static QString unitKeyFromCombo(QComboBox* combo);
-    static QString formatNumber(double v);
+    static bool tryParseDouble(QStringView text, double& out);
+    static bool evaluateExpression(QStringView text, UnitId unit, double& out);
+    static bool convertUnixTime(QStringView text, UnitId from, UnitId to, char* buf, QLatin1StringView& out);
+    static QLatin1StringView formatNumber(double v, char* buf);
     static void setError(QLineEdit* edit, bool isError);
 };
 #endif // MAINWINDOW_H
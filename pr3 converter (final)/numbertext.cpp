@@ -0,0 +1,71 @@
+#include "numbertext.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+static bool isBlank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+void trimBlanks(const char*& begin, const char*& end)
+{
+    while (begin < end && isBlank(*begin)) ++begin;
+    while (end > begin && isBlank(end[-1])) --end;
+}
+
+bool parseNumber(const char* begin, const char* end, double& out)
+{
+    if (begin < end && *begin == '+' && begin + 1 < end && begin[1] != '-') ++begin;
+    const auto r = std::from_chars(begin, end, out);
+    return r.ec == std::errc() && r.ptr == end && begin != end;
+}
+
+char* formatNumber(double v, char* buf)
+{
+    return std::to_chars(buf, buf + kMaxNumberChars, v).ptr;
+}
+
+// Inserts sep between every three digits of the integer part of [buf, end).
+static char* groupDigits(char* buf, char* end, char sep)
+{
+    char* digits = buf + (*buf == '-' ? 1 : 0);
+    char* intEnd = digits;
+    while (intEnd < end && *intEnd >= '0' && *intEnd <= '9') ++intEnd;
+
+    const std::ptrdiff_t n = intEnd - digits;
+    const std::ptrdiff_t seps = (n - 1) / 3;
+    if (seps <= 0) return end;
+
+    // shift the tail, then fill the integer part backwards
+    std::memmove(intEnd + seps, intEnd, std::size_t(end - intEnd));
+    char* dst = intEnd + seps;
+    char* src = intEnd;
+    for (std::ptrdiff_t i = 0; i < n; ++i) {
+        if (i > 0 && i % 3 == 0) *--dst = sep;
+        *--dst = *--src;
+    }
+    return end + seps;
+}
+
+char* formatNumber(double v, char* buf, const NumberFormat& format)
+{
+    char* const limit = buf + kMaxNumberChars;
+    char* end = nullptr;
+
+    switch (format.style) {
+    case NumberFormat::Style::Shortest:
+        end = std::to_chars(buf, limit, v).ptr;
+        break;
+    case NumberFormat::Style::Fixed:
+        if (std::isfinite(v) && std::fabs(v) < 1e21)
+            end = std::to_chars(buf, limit, v, std::chars_format::fixed, std::clamp(format.precision, 0, 17)).ptr;
+        else
+            end = std::to_chars(buf, limit, v).ptr;
+        break;
+    case NumberFormat::Style::Significant:
+        end = std::to_chars(buf, limit, v, std::chars_format::general, std::clamp(format.precision, 1, 17)).ptr;
+        break;
+    }
+
+    if (format.groupSeparator) end = groupDigits(buf, end, format.groupSeparator);
+    return end;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Longest text formatNumber() writes.
+inline constexpr std::size_t kMaxNumberChars = 64;
+
+struct NumberFormat {
+    enum class Style : std::uint8_t {
+        Shortest,    // shortest text that parses back to the same double
+        Fixed,       // precision digits after the point (|v| >= 1e21 falls back to Shortest)
+        Significant  // precision significant digits, like printf("%.*g")
+    };
+
+    Style style = Style::Shortest;
+    int precision = 6;       // clamped to 0..17 (Fixed) or 1..17 (Significant)
+    char groupSeparator = 0; // put between every three integer digits; 0 for none
+};
+
+// Narrows [begin, end) past leading and trailing spaces, tabs and '\r'.
+void trimBlanks(const char*& begin, const char*& end);
+
+// Parses all of [begin, end) as a number (std::from_chars rules plus an optional leading '+').
+bool parseNumber(const char* begin, const char* end, double& out);
+
+// Write v into buf, which must hold kMaxNumberChars; return the end of the text.
+// Shortest output uses std::to_chars, which is Ryu-based in libstdc++, libc++ and MSVC.
+char* formatNumber(double v, char* buf);
+char* formatNumber(double v, char* buf, const NumberFormat& format);
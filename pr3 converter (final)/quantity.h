@@ -0,0 +1,104 @@
+#pragma once
+#include "affine.h"
+#include "unitregistry.h"
+
+// Compile-time typed layer over the unit registry:
+//
+//     units::Quantity<units::Length, units::ft> h(6.0);
+//     auto m = units::quantity_cast<units::m>(h);   // folds to h.value() * 0.3048
+//
+// Dimensions are checked with static_assert and the fused coefficients are computed by
+// the compiler, so a cast costs one multiply-add with constant operands.
+namespace units {
+
+template <UnitMode M>
+struct Dimension {
+    static constexpr UnitMode mode = M;
+};
+
+using Length = Dimension<UnitMode::Length>;
+using Mass = Dimension<UnitMode::Mass>;
+using Temperature = Dimension<UnitMode::Temperature>;
+using Area = Dimension<UnitMode::Area>;
+using Volume = Dimension<UnitMode::Volume>;
+using Speed = Dimension<UnitMode::Speed>;
+using Pressure = Dimension<UnitMode::Pressure>;
+using Energy = Dimension<UnitMode::Energy>;
+using Power = Dimension<UnitMode::Power>;
+using Duration = Dimension<UnitMode::Duration>;
+using DataSize = Dimension<UnitMode::DataSize>;
+using Angle = Dimension<UnitMode::Angle>;
+using Frequency = Dimension<UnitMode::Frequency>;
+using Force = Dimension<UnitMode::Force>;
+
+template <UnitId Id>
+struct Unit {
+    static_assert(isValidUnit(Id), "not a registry unit");
+    static constexpr UnitId id = Id;
+    static constexpr UnitMode mode = unitInfo(Id).mode;
+};
+
+using m = Unit<UnitId::Meter>;
+using km = Unit<UnitId::Kilometer>;
+using in = Unit<UnitId::Inch>;
+using ft = Unit<UnitId::Foot>;
+using mi = Unit<UnitId::Mile>;
+using kg = Unit<UnitId::Kilogram>;
+using lb = Unit<UnitId::Pound>;
+using oz = Unit<UnitId::Ounce>;
+using degC = Unit<UnitId::Celsius>;
+using degF = Unit<UnitId::Fahrenheit>;
+using K = Unit<UnitId::Kelvin>;
+
+template <typename From, typename To>
+inline constexpr Affine kFactor = foldAffine(unitInfo(From::id), unitInfo(To::id));
+
+template <typename Dim, typename U>
+class Quantity
+{
+    static_assert(Dim::mode == U::mode, "unit does not measure this dimension");
+
+public:
+    using dimension = Dim;
+    using unit = U;
+
+    constexpr Quantity() = default;
+    constexpr explicit Quantity(double value) : value_(value) {}
+
+    constexpr double value() const { return value_; }
+    static constexpr UnitId unitId() { return U::id; }
+
+    constexpr Quantity& operator+=(Quantity other) { value_ += other.value_; return *this; }
+    constexpr Quantity& operator-=(Quantity other) { value_ -= other.value_; return *this; }
+    constexpr Quantity& operator*=(double k) { value_ *= k; return *this; }
+    constexpr Quantity& operator/=(double k) { value_ /= k; return *this; }
+
+    friend constexpr Quantity operator+(Quantity a, Quantity b) { return a += b; }
+    friend constexpr Quantity operator-(Quantity a, Quantity b) { return a -= b; }
+    friend constexpr Quantity operator*(Quantity a, double k) { return a *= k; }
+    friend constexpr Quantity operator*(double k, Quantity a) { return a *= k; }
+    friend constexpr Quantity operator/(Quantity a, double k) { return a /= k; }
+    friend constexpr auto operator<=>(Quantity a, Quantity b) = default;
+
+private:
+    double value_ = 0.0;
+};
+
+// Quantity with the dimension taken from the unit: QuantityOf<ft> == Quantity<Length, ft>.
+template <typename U>
+using QuantityOf = Quantity<Dimension<U::mode>, U>;
+
+template <typename To, typename Dim, typename From>
+constexpr Quantity<Dim, To> quantity_cast(Quantity<Dim, From> q)
+{
+    static_assert(To::mode == Dim::mode, "quantity_cast between different dimensions");
+    constexpr Affine a = kFactor<From, To>;
+    if constexpr (From::id == To::id)
+        return q;
+    else if constexpr (a.offset == 0.0)
+        return Quantity<Dim, To>(q.value() * a.scale + a.offset); // rounds like fma with a zero addend, without the libm call
+    else
+        return Quantity<Dim, To>(a.apply(q.value()));
+}
+
+} // namespace units
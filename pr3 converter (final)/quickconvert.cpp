@@ -0,0 +1,115 @@
+#include "quickconvert.h"
+#include "converter.h"
+#include "unitindex.h"
+#include <array>
+#include <charconv>
+
+namespace {
+
+bool isSpace(char c)
+{
+    return c == ' ' || c == '\t';
+}
+
+bool equalsFolded(std::string_view word, std::string_view lower)
+{
+    if (word.size() != lower.size()) return false;
+    for (std::size_t i = 0; i < word.size(); ++i) {
+        const char c = (word[i] >= 'A' && word[i] <= 'Z') ? char(word[i] - 'A' + 'a') : word[i];
+        if (c != lower[i]) return false;
+    }
+    return true;
+}
+
+bool isSeparator(std::string_view word)
+{
+    return word == "->" || word == "=" || equalsFolded(word, "in") || equalsFolded(word, "to")
+           || equalsFolded(word, "as") || equalsFolded(word, "into");
+}
+
+// Words of text: runs of non-blanks, with "->" and "=" split off as words of their own.
+constexpr std::size_t kMaxWords = 16;
+
+std::size_t splitWords(std::string_view text, std::array<std::string_view, kMaxWords>& words)
+{
+    std::size_t n = 0;
+    std::size_t i = 0;
+    while (i < text.size() && n < kMaxWords) {
+        if (isSpace(text[i])) { ++i; continue; }
+        std::size_t len = 0;
+        if (text.compare(i, 2, "->") == 0) {
+            len = 2;
+        } else if (text[i] == '=') {
+            len = 1;
+        } else {
+            while (i + len < text.size() && !isSpace(text[i + len]) && text[i + len] != '='
+                   && text.compare(i + len, 2, "->") != 0)
+                ++len;
+        }
+        words[n++] = text.substr(i, len);
+        i += len;
+    }
+    return i < text.size() ? kMaxWords + 1 : n;
+}
+
+// Text from the first to the last of words[first, last), including the blanks between them.
+std::string_view span(const std::array<std::string_view, kMaxWords>& words, std::size_t first, std::size_t last)
+{
+    const char* begin = words[first].data();
+    const char* end = words[last - 1].data() + words[last - 1].size();
+    return std::string_view(begin, std::size_t(end - begin));
+}
+
+} // namespace
+
+QuickConvertError quickConvert(std::string_view text, QuickConversion& out)
+{
+    out = {};
+    while (!text.empty() && isSpace(text.front())) text.remove_prefix(1);
+    while (!text.empty() && isSpace(text.back())) text.remove_suffix(1);
+    if (text.empty()) return QuickConvertError::Empty;
+
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    if (*begin == '+' && begin + 1 < end && begin[1] != '-') ++begin;
+    const auto parsed = std::from_chars(begin, end, out.value);
+    if (parsed.ec != std::errc()) return QuickConvertError::NoNumber;
+
+    std::array<std::string_view, kMaxWords> words;
+    const std::size_t n = splitWords(std::string_view(parsed.ptr, std::size_t(end - parsed.ptr)), words);
+    if (n == 0) return QuickConvertError::NoUnit;
+    if (n > kMaxWords) return QuickConvertError::UnknownUnit;
+
+    // Try each separator; the first one with both sides resolvable wins.
+    bool unknownTarget = false;
+    for (std::size_t k = 1; k + 1 < n; ++k) {
+        if (!isSeparator(words[k])) continue;
+        const UnitId from = bestUnitMatch(span(words, 0, k));
+        if (!isValidUnit(from)) continue;
+
+        out.from = from;
+        const std::string_view target = span(words, k + 1, n);
+        UnitMatch inMode;
+        UnitMatch anyMode;
+        if (matchUnitName(target, &inMode, 1, unitInfo(from).mode) == 0 || inMode.score < kMinUnitMatchScore) {
+            unknownTarget = true;
+            continue;
+        }
+        // "1 lb to m" should not quietly become milligrams: an exact name in another mode
+        // beats a loose match in this one.
+        if (inMode.score < kExactNameScore && matchUnitName(target, &anyMode, 1) != 0
+            && anyMode.score >= kExactNameScore) {
+            out.to = anyMode.id;
+            return QuickConvertError::ModeMismatch;
+        }
+        out.to = inMode.id;
+        Converter::tryConvert(from, out.to, out.value, out.result);
+        return QuickConvertError::None;
+    }
+    if (unknownTarget) return QuickConvertError::UnknownTarget;
+
+    // No usable separator: the whole rest may still name the source unit.
+    out.from = bestUnitMatch(span(words, 0, n));
+    if (isValidUnit(out.from)) return QuickConvertError::NoTarget;
+    return QuickConvertError::UnknownUnit;
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+#include "unitregistry.h"
+
+enum class QuickConvertError : std::uint8_t {
+    None,
+    Empty,
+    NoNumber,      // the text does not start with a number
+    NoUnit,        // a number, but no unit after it
+    UnknownUnit,   // the source unit matches nothing
+    NoTarget,      // "12.5 ft" without "in <unit>"; from is set
+    UnknownTarget, // the target matches no unit of the source's mode; from is set
+    ModeMismatch,  // the target names a unit of another mode ("1 lb to m"); from and to are set
+};
+
+struct QuickConversion {
+    double value = 0.0;
+    UnitId from = UnitId::Invalid;
+    UnitId to = UnitId::Invalid;
+    double result = 0.0;
+};
+
+// Parses and converts free text: "<number> <unit> in|to|as|into|->|= <unit>", e.g. "12.5 ft in m",
+// "98.6F to C" or "3 kilometres -> miles". Units are resolved with matchUnitName (unitindex.h),
+// the target within the source unit's mode, so "C" after a temperature means Celsius.
+// Multi-word unit names work; "12 in in cm" splits at the separator that leaves both sides
+// resolvable. out is filled as far as parsing got, even on failure.
+QuickConvertError quickConvert(std::string_view text, QuickConversion& out);
@@ -0,0 +1,175 @@
+#include "serviceprotocol.h"
+#include "batchkernels.h"
+#include "converter.h"
+
+#include <QSysInfo>
+#include <QtEndian>
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+constexpr std::size_t kResponseHeaderBytes = 4 + 4 + 4; // id, status + padding, count
+
+std::uint32_t readU32(const char* p)
+{
+    return qFromLittleEndian<quint32>(p);
+}
+
+void appendU32(QByteArray& out, std::uint32_t v)
+{
+    char b[4];
+    qToLittleEndian<quint32>(v, b);
+    out.append(b, 4);
+}
+
+// Sequential reader over one frame's payload; any overrun marks it malformed.
+struct Reader {
+    const char* p;
+    const char* end;
+    bool ok = true;
+
+    const char* take(std::size_t n)
+    {
+        if (!ok || std::size_t(end - p) < n) {
+            ok = false;
+            return nullptr;
+        }
+        const char* at = p;
+        p += n;
+        return at;
+    }
+
+    std::uint32_t u32()
+    {
+        const char* at = take(4);
+        return at ? readU32(at) : 0;
+    }
+
+    std::uint8_t u8()
+    {
+        const char* at = take(1);
+        return at ? std::uint8_t(*at) : 0;
+    }
+};
+
+// Length prefix of the frame at data: Incomplete until the whole frame is buffered.
+FrameState framePayload(const char* data, std::size_t size, Reader& payload, std::size_t& frameBytes)
+{
+    if (size < kServiceLengthBytes) return FrameState::Incomplete;
+    const std::uint32_t length = readU32(data);
+    if (length > kMaxServiceFrameBytes) return FrameState::Malformed;
+    if (size - kServiceLengthBytes < length) return FrameState::Incomplete;
+
+    frameBytes = kServiceLengthBytes + length;
+    payload = { data + kServiceLengthBytes, data + frameBytes };
+    return FrameState::Complete;
+}
+
+} // namespace
+
+FrameState parseServiceRequest(const char* data, std::size_t size, ServiceRequest& out, std::size_t& frameBytes)
+{
+    Reader r{ nullptr, nullptr };
+    if (const FrameState s = framePayload(data, size, r, frameBytes); s != FrameState::Complete) return s;
+
+    out.id = r.u32();
+    const std::uint8_t fromLength = r.u8();
+    const char* from = r.take(fromLength);
+    const std::uint8_t toLength = r.u8();
+    const char* to = r.take(toLength);
+    out.count = r.u32();
+    out.values = r.take(std::size_t(out.count) * sizeof(double));
+    if (!r.ok || r.p != r.end) return FrameState::Malformed;
+
+    out.from = std::string_view(from, fromLength);
+    out.to = std::string_view(to, toLength);
+    return FrameState::Complete;
+}
+
+FrameState parseServiceResponse(const char* data, std::size_t size, ServiceResponse& out, std::size_t& frameBytes)
+{
+    Reader r{ nullptr, nullptr };
+    if (const FrameState s = framePayload(data, size, r, frameBytes); s != FrameState::Complete) return s;
+
+    out.id = r.u32();
+    out.status = ServiceStatus(r.u8());
+    r.take(3);
+    out.count = r.u32();
+    out.values = r.take(std::size_t(out.count) * sizeof(double));
+    return r.ok && r.p == r.end ? FrameState::Complete : FrameState::Malformed;
+}
+
+void appendServiceRequest(QByteArray& out, std::uint32_t id, std::string_view from, std::string_view to,
+                          std::span<const double> values)
+{
+    const std::size_t length = 4 + 1 + from.size() + 1 + to.size() + 4 + values.size_bytes();
+    out.reserve(out.size() + qsizetype(kServiceLengthBytes + length));
+    appendU32(out, std::uint32_t(length));
+    appendU32(out, id);
+    out.append(char(from.size()));
+    out.append(from.data(), qsizetype(from.size()));
+    out.append(char(to.size()));
+    out.append(to.data(), qsizetype(to.size()));
+    appendU32(out, std::uint32_t(values.size()));
+
+    const qsizetype at = out.size();
+    out.resize(at + qsizetype(values.size_bytes()));
+    qToLittleEndian<double>(values.data(), qsizetype(values.size()), out.data() + at);
+}
+
+void appendServiceError(QByteArray& out, std::uint32_t id, ServiceStatus status)
+{
+    appendU32(out, std::uint32_t(kResponseHeaderBytes));
+    appendU32(out, id);
+    appendU32(out, std::uint32_t(status));
+    appendU32(out, 0);
+}
+
+void appendServiceResponse(QByteArray& out, const ServiceRequest& request)
+{
+    const UnitId from = unitIdFromKey(request.from);
+    const UnitId to = unitIdFromKey(request.to);
+    if (!isValidUnit(from) || !isValidUnit(to)) {
+        appendServiceError(out, request.id, ServiceStatus::UnknownUnit);
+        return;
+    }
+    if (unitInfo(from).mode != unitInfo(to).mode) {
+        appendServiceError(out, request.id, ServiceStatus::ModeMismatch);
+        return;
+    }
+
+    const std::size_t bytes = std::size_t(request.count) * sizeof(double);
+    appendU32(out, std::uint32_t(kResponseHeaderBytes + bytes));
+    appendU32(out, request.id);
+    appendU32(out, std::uint32_t(ServiceStatus::Ok));
+    appendU32(out, request.count);
+
+    const qsizetype at = out.size();
+    out.resize(at + qsizetype(bytes));
+    char* values = out.data() + at;
+    std::memcpy(values, request.values, bytes);
+
+    // Converted in place when the values landed 8-byte aligned (the usual case, see the
+    // header padding); otherwise through an aligned chunk on the stack.
+    const Converter::Affine a = Converter::coefficients(from, to);
+    if (QSysInfo::ByteOrder == QSysInfo::LittleEndian && reinterpret_cast<std::uintptr_t>(values) % alignof(double) == 0) {
+        double* v = reinterpret_cast<double*>(values);
+        affineBatch(v, v, request.count, a.scale, a.offset);
+        return;
+    }
+    double chunk[512];
+    for (std::size_t i = 0; i < request.count; i += std::size(chunk)) {
+        const std::size_t n = std::min<std::size_t>(std::size(chunk), request.count - i);
+        qFromLittleEndian<double>(values + i * sizeof(double), qsizetype(n), chunk);
+        affineBatch(chunk, chunk, n, a.scale, a.offset);
+        qToLittleEndian<double>(chunk, qsizetype(n), values + i * sizeof(double));
+    }
+}
+
+void readServiceValues(const ServiceResponse& response, std::span<double> out)
+{
+    qFromLittleEndian<double>(response.values, qsizetype(response.count), out.data());
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <QByteArray>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Wire format of convert-service. Every integer and value is little-endian; a connection
+// carries a sequence of frames in each direction, each prefixed by its length:
+//
+//   request:  u32 length   bytes after this field
+//             u32 id       echoed in the response, so clients can pipeline requests
+//             u8  n, n bytes of UTF-8: unit to convert from (key or alias, as in units.catalog)
+//             u8  n, n bytes of UTF-8: unit to convert to
+//             u32 count
+//             f64 values[count]
+//
+//   response: u32 length
+//             u32 id
+//             u8  status (ServiceStatus), then 3 zero bytes
+//             u32 count    0 unless status is Ok
+//             f64 values[count]
+//
+// The padding puts response values 8 bytes into a 16-byte frame header, so back-to-back
+// responses keep them aligned. Responses come back in request order. Frames longer than kMaxServiceFrameBytes are a
+// protocol error: the server answers BadRequest and closes the connection.
+
+inline constexpr std::uint32_t kMaxServiceFrameBytes = 64u << 20;
+inline constexpr std::size_t kServiceLengthBytes = 4;
+
+enum class ServiceStatus : std::uint8_t {
+    Ok,
+    UnknownUnit,
+    ModeMismatch,
+    BadRequest // malformed or oversized frame
+};
+
+struct ServiceRequest {
+    std::uint32_t id = 0;
+    std::string_view from;
+    std::string_view to;
+    std::uint32_t count = 0;
+    const char* values = nullptr; // count little-endian f64, unaligned
+};
+
+struct ServiceResponse {
+    std::uint32_t id = 0;
+    ServiceStatus status = ServiceStatus::Ok;
+    std::uint32_t count = 0;
+    const char* values = nullptr;
+};
+
+enum class FrameState { Incomplete, Complete, Malformed };
+
+// Reads one frame from the front of [data, data + size). On Complete, frameBytes is its
+// total size including the length prefix and out points into data.
+FrameState parseServiceRequest(const char* data, std::size_t size, ServiceRequest& out, std::size_t& frameBytes);
+FrameState parseServiceResponse(const char* data, std::size_t size, ServiceResponse& out, std::size_t& frameBytes);
+
+// Appends one encoded frame to out.
+void appendServiceRequest(QByteArray& out, std::uint32_t id, std::string_view from, std::string_view to,
+                          std::span<const double> values);
+void appendServiceError(QByteArray& out, std::uint32_t id, ServiceStatus status);
+
+// Converts request and appends its response to out. The values go straight from the
+// request bytes into the response frame and are converted there in one batch pass.
+void appendServiceResponse(QByteArray& out, const ServiceRequest& request);
+
+// Copies the response's values into out (at least response.count long).
+void readServiceValues(const ServiceResponse& response, std::span<double> out);
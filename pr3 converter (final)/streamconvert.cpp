@@ -0,0 +1,270 @@
+#include "streamconvert.h"
+#include "batchkernels.h"
+#include "converter.h"
+#include "decimalconvert.h"
+#include "numbertext.h"
+
+#include <QThread>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kBlockSize = 1 << 20;
+
+struct NumberField {
+    std::size_t begin;
+    std::size_t end;
+};
+
+class TextConverter
+{
+public:
+    TextConverter(std::FILE* out, const Converter::Affine& a, const NumberFormat& format)
+        : out_(out), affine_(a), format_(format) {}
+
+    // Converts through decimal instead, rounded to what the format will print.
+    void setDecimal(UnitId from, UnitId to)
+    {
+        DecimalRounding rounding;
+        if (format_.style == NumberFormat::Style::Fixed)
+            rounding = { DecimalRounding::Style::Fixed, format_.precision };
+        else if (format_.style == NumberFormat::Style::Significant)
+            rounding = { DecimalRounding::Style::Significant, format_.precision };
+        decimal_.emplace(from, to, rounding);
+    }
+
+    // data holds whole lines only (the last one may lack its '\n' at end of input).
+    bool processBlock(const char* data, std::size_t size, std::string& error)
+    {
+        fields_.clear();
+        values_.clear();
+
+        const char* const end = data + size;
+        const char* fieldStart = data;
+        for (const char* p = data; ; ++p) {
+            const bool atEnd = (p == end);
+            if (!atEnd && *p != ',' && *p != '\n') continue;
+
+            const char* nb = fieldStart;
+            const char* ne = p;
+            trimBlanks(nb, ne);
+            double v = 0.0;
+            if (parseNumber(nb, ne, v)) {
+                fields_.push_back({ static_cast<std::size_t>(nb - data), static_cast<std::size_t>(ne - data) });
+                values_.push_back(v);
+            } else if (nb != ne) {
+                const long long lineNo = line_ + std::count(data, nb, '\n');
+                error = "line " + std::to_string(lineNo) + ": not a number: '" + std::string(nb, ne) + "'";
+                return false;
+            }
+            if (atEnd) break;
+            fieldStart = p + 1;
+        }
+        line_ += std::count(data, end, '\n');
+
+        if (decimal_) decimal_->convert(values_, values_);
+        else affineBatch(values_.data(), values_.data(), values_.size(), affine_.scale, affine_.offset);
+
+        outBuf_.clear();
+        outBuf_.reserve(size + values_.size() * kMaxNumberChars);
+        std::size_t cursor = 0;
+        char num[kMaxNumberChars];
+        for (std::size_t i = 0; i < fields_.size(); ++i) {
+            outBuf_.append(data + cursor, fields_[i].begin - cursor);
+            outBuf_.append(num, formatNumber(values_[i], num, format_));
+            cursor = fields_[i].end;
+        }
+        outBuf_.append(data + cursor, size - cursor);
+
+        if (std::fwrite(outBuf_.data(), 1, outBuf_.size(), out_) != outBuf_.size()) {
+            error = "write failed";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::FILE* out_;
+    Converter::Affine affine_;
+    NumberFormat format_;
+    std::optional<DecimalConverter> decimal_;
+    long long line_ = 1;
+    std::vector<NumberField> fields_;
+    std::vector<double> values_;
+    std::string outBuf_;
+};
+
+class TimestampConverter
+{
+public:
+    TimestampConverter(std::FILE* out, const TimestampFormat& from, const TimestampFormat& to)
+        : out_(out), fromStyle_(from.style), toStyle_(to.style), fromZone_(from.zone), toZone_(to.zone) {}
+
+    // data holds whole lines only (the last one may lack its '\n' at end of input).
+    bool processBlock(const char* data, std::size_t size, std::string& error)
+    {
+        outBuf_.clear();
+        outBuf_.reserve(size + size / 2);
+
+        const char* const end = data + size;
+        const char* fieldStart = data;
+        const char* copied = data;
+        char text[kMaxTimestampChars];
+        for (const char* p = data; ; ++p) {
+            const bool atEnd = (p == end);
+            if (!atEnd && *p != ',' && *p != '\n') continue;
+
+            const char* nb = fieldStart;
+            const char* ne = p;
+            trimBlanks(nb, ne);
+            if (nb != ne) {
+                Instant t;
+                if (!parseTimestamp(nb, ne, fromStyle_, fromZone_, t)) {
+                    const long long lineNo = line_ + std::count(data, nb, '\n');
+                    error = "line " + std::to_string(lineNo) + ": not a timestamp: '" + std::string(nb, ne) + "'";
+                    return false;
+                }
+                outBuf_.append(copied, nb);
+                outBuf_.append(text, formatTimestamp(t, toStyle_, toZone_, text));
+                copied = ne;
+            }
+            if (atEnd) break;
+            fieldStart = p + 1;
+        }
+        outBuf_.append(copied, end);
+        line_ += std::count(data, end, '\n');
+
+        if (std::fwrite(outBuf_.data(), 1, outBuf_.size(), out_) != outBuf_.size()) {
+            error = "write failed";
+            return false;
+        }
+        return true;
+    }
+
+private:
+    std::FILE* out_;
+    TimestampStyle fromStyle_;
+    TimestampStyle toStyle_;
+    TimeZone::Cursor fromZone_; // one cursor per side, so sorted input stays in its span
+    TimeZone::Cursor toZone_;
+    long long line_ = 1;
+    std::string outBuf_;
+};
+
+// Reads in and hands conv whole lines, a block at a time.
+template <typename BlockConverter>
+bool streamLines(std::FILE* in, BlockConverter& conv, std::string& error)
+{
+    std::vector<char> buf(kBlockSize);
+    std::size_t filled = 0;
+    for (;;) {
+        if (filled == buf.size()) buf.resize(buf.size() * 2); // a single line longer than the buffer
+        const std::size_t n = std::fread(buf.data() + filled, 1, buf.size() - filled, in);
+        filled += n;
+        const bool eof = (n == 0);
+
+        if (eof) {
+            if (std::ferror(in)) { error = "read failed"; return false; }
+            return filled == 0 || conv.processBlock(buf.data(), filled, error);
+        }
+
+        // hand over whole lines only, keep the tail for the next read
+        std::size_t used = filled;
+        while (used > 0 && buf[used - 1] != '\n') --used;
+        if (used == 0) continue;
+
+        if (!conv.processBlock(buf.data(), used, error)) return false;
+        std::memmove(buf.data(), buf.data() + used, filled - used);
+        filled -= used;
+    }
+}
+
+// Below this many bytes per thread, starting threads costs more than it saves.
+constexpr std::size_t kMinParseBytesPerThread = 1 << 20;
+
+void parseFields(const char* begin, const char* end, std::vector<double>& values, std::size_t& bad)
+{
+    // ~8 bytes per number is typical; reserving avoids most regrowth
+    values.reserve(values.size() + std::size_t(end - begin) / 8);
+    const char* fieldStart = begin;
+    for (const char* p = begin; ; ++p) {
+        const bool atEnd = (p == end);
+        if (!atEnd && *p != ',' && *p != '\n') continue;
+
+        const char* nb = fieldStart;
+        const char* ne = p;
+        trimBlanks(nb, ne);
+        if (nb != ne) {
+            double v = 0.0;
+            if (!parseNumber(nb, ne, v)) {
+                v = std::numeric_limits<double>::quiet_NaN();
+                ++bad;
+            }
+            values.push_back(v);
+        }
+        if (atEnd) break;
+        fieldStart = p + 1;
+    }
+}
+
+} // namespace
+
+void parseNumberList(const char* begin, const char* end, int threads, std::vector<double>& values,
+                     std::size_t& bad)
+{
+    values.clear();
+    bad = 0;
+    const std::size_t size = std::size_t(end - begin);
+    if (threads <= 0) threads = QThread::idealThreadCount();
+    threads = int(std::clamp<std::size_t>(size / kMinParseBytesPerThread, 1, std::size_t(std::max(threads, 1))));
+    if (threads == 1) {
+        parseFields(begin, end, values, bad);
+        return;
+    }
+
+    // chunks end just after a separator, so no field is cut in two
+    std::vector<const char*> cuts{ begin };
+    for (int t = 1; t < threads; ++t) {
+        const char* p = std::max(cuts.back(), begin + size * std::size_t(t) / std::size_t(threads));
+        while (p < end && *p != '\n' && *p != ',') ++p;
+        cuts.push_back(p < end ? p + 1 : end);
+    }
+    cuts.push_back(end);
+
+    std::vector<std::vector<double>> parts(static_cast<std::size_t>(threads));
+    std::vector<std::size_t> partBad(parts.size(), 0);
+    std::vector<std::thread> pool;
+    for (std::size_t t = 1; t < parts.size(); ++t)
+        pool.emplace_back(parseFields, cuts[t], cuts[t + 1], std::ref(parts[t]), std::ref(partBad[t]));
+    parseFields(cuts[0], cuts[1], parts[0], partBad[0]);
+    for (std::thread& th : pool) th.join();
+
+    std::size_t total = 0;
+    for (const auto& part : parts) total += part.size();
+    values.reserve(total);
+    for (std::size_t t = 0; t < parts.size(); ++t) {
+        values.insert(values.end(), parts[t].begin(), parts[t].end());
+        bad += partBad[t];
+    }
+}
+
+bool convertTextStream(std::FILE* in, std::FILE* out, UnitId from, UnitId to, std::string& error,
+                       const NumberFormat& format, bool exact)
+{
+    TextConverter conv(out, Converter::coefficients(from, to), format);
+    if (exact) conv.setDecimal(from, to);
+    return streamLines(in, conv, error);
+}
+
+bool convertTimestampStream(std::FILE* in, std::FILE* out, const TimestampFormat& from, const TimestampFormat& to,
+                            std::string& error)
+{
+    TimestampConverter conv(out, from, to);
+    return streamLines(in, conv, error);
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "numbertext.h"
+#include "timestamp.h"
+#include "unitregistry.h"
+
+// Streams newline- or comma-separated numbers from in to out, converting each one.
+// Separators, blank fields and the whitespace around numbers are copied through unchanged.
+// Returns false and describes the first malformed field in error (output stops there).
+// With exact, values are converted as the decimals they were written as and rounded
+// correctly to the format's precision (15 significant digits for Shortest); see
+// DecimalConverter.
+bool convertTextStream(std::FILE* in, std::FILE* out, UnitId from, UnitId to, std::string& error,
+                       const NumberFormat& format = {}, bool exact = false);
+
+// Like convertTextStream, for fields that are timestamps: each is read in from's form and
+// written in to's. Each side keeps a zone cursor, so sorted input such as a log's costs
+// O(1) amortized per field.
+bool convertTimestampStream(std::FILE* in, std::FILE* out, const TimestampFormat& from, const TimestampFormat& to,
+                            std::string& error);
+
+// Parses newline- or comma-separated numbers from [begin, end) into values, in input order,
+// split across threads on field boundaries. Blank fields are skipped; anything else that is
+// not a number becomes NaN and is counted in bad. threads <= 0 uses the ideal thread count.
+void parseNumberList(const char* begin, const char* end, int threads, std::vector<double>& values,
+                     std::size_t& bad);
@@ -0,0 +1,298 @@
+#include "timestamp.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+
+namespace {
+
+constexpr std::int64_t kSecondsPerDay = 86400;
+constexpr std::int32_t kNanosPerSecond = 1'000'000'000;
+// About two billion years either way; far enough that adding an offset cannot overflow.
+constexpr std::int64_t kMaxUnixSeconds = std::int64_t(1) << 56;
+
+bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+std::int64_t floorDiv(std::int64_t a, std::int64_t b)
+{
+    return a / b - (a % b != 0 && (a % b < 0) != (b < 0));
+}
+
+int daysInMonth(std::int64_t year, int month)
+{
+    static constexpr int kDays[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return kDays[month - 1] + (month == 2 && leap);
+}
+
+// Digits of a Unix count that fall below one second: 0, 3, 6 or 9.
+int subsecondDigits(TimestampStyle style)
+{
+    return 3 * int(style);
+}
+
+char* twoDigits(char* p, std::int64_t v)
+{
+    *p++ = char('0' + v / 10);
+    *p++ = char('0' + v % 10);
+    return p;
+}
+
+// nanos as exactly nine digits
+void nineDigits(std::int32_t nanos, char* digits)
+{
+    for (int i = 8; i >= 0; --i) {
+        digits[i] = char('0' + nanos % 10);
+        nanos /= 10;
+    }
+}
+
+bool parseUnix(const char* p, const char* end, int unitDigits, Instant& out)
+{
+    const bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) ++p;
+    const char* wholeBegin = p;
+    while (p < end && isDigit(*p)) ++p;
+    const char* wholeEnd = p;
+    const char* fractionBegin = p;
+    if (p < end && *p == '.') fractionBegin = ++p;
+    while (p < end && isDigit(*p)) ++p;
+    if (p != end || (wholeBegin == wholeEnd && fractionBegin == end)) return false;
+
+    // the whole count's last unitDigits digits and the fraction are the part below a second:
+    // 1700000000123.5 ms is second 1700000000 and nanoseconds 123500000
+    const char* secondsEnd = wholeEnd - std::min<std::ptrdiff_t>(wholeEnd - wholeBegin, unitDigits);
+    std::int64_t seconds = 0;
+    for (const char* q = wholeBegin; q < secondsEnd; ++q) {
+        seconds = seconds * 10 + (*q - '0');
+        if (seconds > kMaxUnixSeconds) return false;
+    }
+    std::int32_t nanos = 0;
+    int written = unitDigits - int(wholeEnd - secondsEnd); // leading zeros: 5 ms is 005
+    for (const char* q = secondsEnd; q < wholeEnd; ++q, ++written) nanos = nanos * 10 + (*q - '0');
+    for (const char* q = fractionBegin; q < end && written < 9; ++q, ++written) nanos = nanos * 10 + (*q - '0');
+    for (; written < 9; ++written) nanos *= 10;
+
+    if (negative && nanos > 0) {
+        seconds = -seconds - 1;
+        nanos = kNanosPerSecond - nanos;
+    } else if (negative) {
+        seconds = -seconds;
+    }
+    out = { seconds, nanos };
+    return true;
+}
+
+char* formatUnix(const Instant& t, int unitDigits, char* p)
+{
+    // as a magnitude and a sign, since -1.5 s is second -2 plus half a second
+    std::uint64_t seconds = std::uint64_t(t.seconds);
+    std::int32_t nanos = t.nanos;
+    if (t.seconds < 0) {
+        *p++ = '-';
+        seconds = std::uint64_t(0) - seconds;
+        if (nanos > 0) {
+            seconds -= 1;
+            nanos = kNanosPerSecond - nanos;
+        }
+    }
+    char digits[9];
+    nineDigits(nanos, digits);
+
+    // the whole count: seconds, then the nanoseconds' first unitDigits digits
+    if (seconds > 0) {
+        p = std::to_chars(p, p + 20, seconds).ptr;
+        std::memcpy(p, digits, std::size_t(unitDigits));
+        p += unitDigits;
+    } else if (unitDigits == 0) {
+        *p++ = '0';
+    } else {
+        int first = 0;
+        while (first < unitDigits - 1 && digits[first] == '0') ++first;
+        std::memcpy(p, digits + first, std::size_t(unitDigits - first));
+        p += unitDigits - first;
+    }
+
+    int last = 9;
+    while (last > unitDigits && digits[last - 1] == '0') --last;
+    if (last > unitDigits) {
+        *p++ = '.';
+        std::memcpy(p, digits + unitDigits, std::size_t(last - unitDigits));
+        p += last - unitDigits;
+    }
+    return p;
+}
+
+bool parseIso(const char* p, const char* end, TimeZone::Cursor& zone, Instant& out)
+{
+    auto number = [&](int digits, int& v) {
+        if (end - p < digits) return false;
+        v = 0;
+        for (int i = 0; i < digits; ++i, ++p) {
+            if (!isDigit(*p)) return false;
+            v = v * 10 + (*p - '0');
+        }
+        return true;
+    };
+    auto expect = [&](char c) { return p < end && *p++ == c; };
+
+    int year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+    if (!number(4, year) || !expect('-') || !number(2, month) || !expect('-') || !number(2, day)) return false;
+    if (month < 1 || month > 12 || day < 1 || day > daysInMonth(year, month)) return false;
+
+    std::int32_t nanos = 0;
+    if (p < end && (*p == 'T' || *p == 't' || *p == ' ')) {
+        ++p;
+        if (!number(2, hour) || !expect(':') || !number(2, minute)) return false;
+        if (p < end && *p == ':') {
+            ++p;
+            if (!number(2, second)) return false;
+            if (p < end && (*p == '.' || *p == ',')) {
+                const char* fraction = ++p;
+                int written = 0;
+                for (; p < end && isDigit(*p); ++p) {
+                    if (written < 9) {
+                        nanos = nanos * 10 + (*p - '0');
+                        ++written;
+                    }
+                }
+                if (p == fraction) return false;
+                for (; written < 9; ++written) nanos *= 10;
+            }
+        }
+        if (hour > 23 || minute > 59 || second > 59) return false;
+    }
+    const std::int64_t local = daysFromCivil(year, month, day) * kSecondsPerDay + hour * 3600 + minute * 60 + second;
+
+    if (p == end) {
+        out = { zone.toUtc(local), nanos };
+        return true;
+    }
+    int offset = 0;
+    if (*p == 'Z' || *p == 'z') {
+        ++p;
+    } else if (*p == '+' || *p == '-') {
+        const int sign = *p++ == '-' ? -1 : 1;
+        int h = 0, m = 0, s = 0;
+        if (!number(2, h)) return false;
+        if (p < end && *p == ':') {
+            ++p;
+            if (!number(2, m)) return false;
+            if (p < end && *p == ':' && (++p, !number(2, s))) return false;
+        } else if (p < end && !number(2, m)) {
+            return false;
+        }
+        if (h > 23 || m > 59 || s > 59) return false;
+        offset = sign * (h * 3600 + m * 60 + s);
+    }
+    if (p != end) return false;
+    out = { local - offset, nanos };
+    return true;
+}
+
+char* formatIso(const Instant& t, TimeZone::Cursor& zone, char* p)
+{
+    const std::int32_t offset = zone.offsetAt(t.seconds);
+    const std::int64_t local = t.seconds + offset;
+    const std::int64_t days = floorDiv(local, kSecondsPerDay);
+    const std::int64_t secondOfDay = local - days * kSecondsPerDay;
+    std::int64_t year = 0;
+    int month = 0, day = 0;
+    civilFromDays(days, year, month, day);
+
+    // years outside 0000..9999 get a sign, as ISO 8601's expanded form
+    if (year < 0 || year > 9999) *p++ = year < 0 ? '-' : '+';
+    const std::uint64_t absYear = year < 0 ? std::uint64_t(0) - std::uint64_t(year) : std::uint64_t(year);
+    for (std::uint64_t scale = 1000; scale > 1 && absYear < scale; scale /= 10) *p++ = '0';
+    p = std::to_chars(p, p + 20, absYear).ptr;
+    *p++ = '-';
+    p = twoDigits(p, month);
+    *p++ = '-';
+    p = twoDigits(p, day);
+    *p++ = 'T';
+    p = twoDigits(p, secondOfDay / 3600);
+    *p++ = ':';
+    p = twoDigits(p, secondOfDay / 60 % 60);
+    *p++ = ':';
+    p = twoDigits(p, secondOfDay % 60);
+
+    if (t.nanos > 0) {
+        char digits[9];
+        nineDigits(t.nanos, digits);
+        int length = 9;
+        while (length > 3 && std::memcmp(digits + length - 3, "000", 3) == 0) length -= 3;
+        *p++ = '.';
+        std::memcpy(p, digits, std::size_t(length));
+        p += length;
+    }
+
+    if (zone.zone().isUtc()) {
+        *p++ = 'Z';
+        return p;
+    }
+    const std::int32_t absOffset = offset < 0 ? -offset : offset;
+    *p++ = offset < 0 ? '-' : '+';
+    p = twoDigits(p, absOffset / 3600);
+    *p++ = ':';
+    p = twoDigits(p, absOffset / 60 % 60);
+    if (absOffset % 60) { // local mean time before standard zones: -04:56:02
+        *p++ = ':';
+        p = twoDigits(p, absOffset % 60);
+    }
+    return p;
+}
+
+} // namespace
+
+bool timestampStyleForUnit(UnitId unit, TimestampStyle& style)
+{
+    switch (unit) {
+    case UnitId::UnixSeconds: style = TimestampStyle::UnixSeconds; return true;
+    case UnitId::UnixMilliseconds: style = TimestampStyle::UnixMilliseconds; return true;
+    case UnitId::UnixMicroseconds: style = TimestampStyle::UnixMicroseconds; return true;
+    case UnitId::UnixNanoseconds: style = TimestampStyle::UnixNanoseconds; return true;
+    default: return false;
+    }
+}
+
+bool parseTimestampFormat(const QString& spec, TimestampFormat& format, QString& error)
+{
+    const qsizetype at = spec.indexOf(QLatin1Char('@'));
+    const QString style = at < 0 ? spec : spec.left(at);
+
+    if (style == QLatin1String("iso")) {
+        format.style = TimestampStyle::Iso8601;
+    } else {
+        const QByteArray key = style.toUtf8();
+        if (!timestampStyleForUnit(unitIdFromKey(std::string_view(key.constData(), std::size_t(key.size()))),
+                                   format.style)) {
+            error = QStringLiteral("'%1' is not a timestamp format (unix, unix_ms, unix_us, unix_ns or iso)").arg(style);
+            return false;
+        }
+    }
+
+    format.zone = TimeZone::utc();
+    if (at < 0) return true;
+    if (format.style != TimestampStyle::Iso8601) {
+        error = QStringLiteral("'%1': only iso takes a time zone").arg(spec);
+        return false;
+    }
+    format.zone = TimeZone::find(spec.mid(at + 1), error);
+    return format.zone != nullptr;
+}
+
+bool parseTimestamp(const char* begin, const char* end, TimestampStyle style, TimeZone::Cursor& zone,
+                    Instant& out)
+{
+    if (style == TimestampStyle::Iso8601) return parseIso(begin, end, zone, out);
+    return parseUnix(begin, end, subsecondDigits(style), out);
+}
+
+char* formatTimestamp(const Instant& t, TimestampStyle style, TimeZone::Cursor& zone, char* buf)
+{
+    if (style == TimestampStyle::Iso8601) return formatIso(t, zone, buf);
+    return formatUnix(t, subsecondDigits(style), buf);
+}
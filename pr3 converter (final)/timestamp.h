@@ -0,0 +1,53 @@
+#pragma once
+#include <QString>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "timezone.h"
+#include "unitregistry.h"
+
+// Text forms of a point in time: a count since the Unix epoch, or ISO-8601 date and time.
+enum class TimestampStyle : std::uint8_t {
+    UnixSeconds,
+    UnixMilliseconds,
+    UnixMicroseconds,
+    UnixNanoseconds,
+    Iso8601
+};
+
+struct TimestampFormat {
+    TimestampStyle style = TimestampStyle::UnixSeconds;
+    // ISO-8601 only: written as local time in this zone; read in it when the text has no offset
+    std::shared_ptr<const TimeZone> zone = TimeZone::utc();
+};
+
+// Seconds since 1970-01-01T00:00:00Z and nanoseconds into that second. Exact over the whole
+// range, where a double of nanoseconds would be off by hundreds.
+struct Instant {
+    std::int64_t seconds = 0;
+    std::int32_t nanos = 0; // 0..999'999'999, also before 1970
+};
+
+// Longest text formatTimestamp writes.
+inline constexpr std::size_t kMaxTimestampChars = 48;
+
+// The style a Timestamp-mode Unix unit (unix, unix_ms, ...) is written in; false for any
+// other unit, Julian dates included.
+bool timestampStyleForUnit(UnitId unit, TimestampStyle& style);
+
+// "unix", "unix_ms", "unix_us" or "unix_ns" (the Timestamp mode's unit keys and aliases) or
+// "iso", optionally followed by @Zone: "iso@America/New_York".
+bool parseTimestampFormat(const QString& spec, TimestampFormat& format, QString& error);
+
+// Reads [begin, end), written in style; false if it is anything else or out of range.
+// Unix counts are integers or decimals, optionally signed ("-1.5" is 1969-12-31T23:59:58.5Z);
+// digits below a nanosecond are dropped. ISO-8601 is YYYY-MM-DD, optionally followed by
+// T or a space and hh:mm[:ss[.fraction]], then Z or an offset (+hh:mm, +hhmm, +hh); without
+// an offset the time is local in zone.
+bool parseTimestamp(const char* begin, const char* end, TimestampStyle style, TimeZone::Cursor& zone,
+                    Instant& out);
+
+// Writes t to buf (at least kMaxTimestampChars) and returns one past the last character.
+// Unix counts print their fraction only when there is one; ISO-8601 prints local time in
+// zone with a fraction of 3, 6 or 9 digits when non-zero, then Z (UTC) or the offset.
+char* formatTimestamp(const Instant& t, TimestampStyle style, TimeZone::Cursor& zone, char* buf);
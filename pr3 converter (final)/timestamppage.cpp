@@ -0,0 +1,157 @@
+#include "timestamppage.h"
+
+#include <QBoxLayout>
+#include <QComboBox>
+#include <QCompleter>
+#include <QDateTime>
+#include <QEvent>
+#include <QLabel>
+#include <QLineEdit>
+#include <QPushButton>
+#include <QSignalBlocker>
+#include <QTimeZone>
+
+TimestampPage::TimestampPage(QWidget *parent)
+    : QWidget(parent)
+{
+    // start with the machine's own zone on the ISO side, if tzdata knows it
+    const QString local = QString::fromUtf8(QTimeZone::systemTimeZoneId());
+    QString error;
+    const bool knownLocal = !local.isEmpty() && TimeZone::find(local, error);
+    top_ = makeSide(TimestampStyle::UnixSeconds, QStringLiteral("UTC"));
+    bottom_ = makeSide(TimestampStyle::Iso8601, knownLocal ? local : QStringLiteral("UTC"));
+    status_ = new QLabel(tr("Type a Unix time or an ISO-8601 date and time, e.g. 2024-03-10T02:30."), this);
+    auto* now = new QPushButton(tr("&Now"), this);
+
+    auto* layout = new QVBoxLayout(this);
+    for (const Side* side : { &top_, &bottom_ }) {
+        auto* row = new QHBoxLayout;
+        row->addWidget(side->edit, 1);
+        row->addWidget(side->style);
+        row->addWidget(side->zone);
+        layout->addLayout(row);
+    }
+    auto* footer = new QHBoxLayout;
+    footer->addWidget(status_, 1);
+    footer->addWidget(now);
+    layout->addLayout(footer);
+    layout->addStretch();
+
+    connect(top_.edit, &QLineEdit::textEdited, this, [this]{ convert(false); });
+    connect(bottom_.edit, &QLineEdit::textEdited, this, [this]{ convert(true); });
+    for (const Side* side : { &top_, &bottom_ }) {
+        connect(side->style, &QComboBox::currentIndexChanged, this, [this, side]{
+            side->zone->setEnabled(side->style->currentData().toInt() == int(TimestampStyle::Iso8601));
+            convert(bottomIsSource_);
+        });
+        connect(side->zone, &QComboBox::currentTextChanged, this, [this]{ convert(bottomIsSource_); });
+    }
+    connect(now, &QPushButton::clicked, this, &TimestampPage::setNow);
+}
+
+TimestampPage::Side TimestampPage::makeSide(TimestampStyle style, const QString& zone)
+{
+    Side side;
+    side.edit = new QLineEdit(this);
+    side.edit->setClearButtonEnabled(true);
+
+    side.style = new QComboBox(this);
+    side.style->addItem(tr("Unix seconds"), int(TimestampStyle::UnixSeconds));
+    side.style->addItem(tr("Unix milliseconds"), int(TimestampStyle::UnixMilliseconds));
+    side.style->addItem(tr("Unix microseconds"), int(TimestampStyle::UnixMicroseconds));
+    side.style->addItem(tr("Unix nanoseconds"), int(TimestampStyle::UnixNanoseconds));
+    side.style->addItem(tr("ISO 8601"), int(TimestampStyle::Iso8601));
+    side.style->setCurrentIndex(side.style->findData(int(style)));
+
+    // ~600 names, listed on first focus: typing any part of one ("york", "Paris") narrows them
+    side.zone = new QComboBox(this);
+    side.zone->setEditable(true);
+    side.zone->setInsertPolicy(QComboBox::NoInsert);
+    side.zone->addItem(zone);
+    side.zone->installEventFilter(this);
+    side.zone->completer()->setFilterMode(Qt::MatchContains);
+    side.zone->completer()->setCaseSensitivity(Qt::CaseInsensitive);
+    side.zone->completer()->setCompletionMode(QCompleter::PopupCompletion);
+    side.zone->setEnabled(style == TimestampStyle::Iso8601);
+    return side;
+}
+
+bool TimestampPage::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::FocusIn && !zonesListed_ && (watched == top_.zone || watched == bottom_.zone))
+        listZones();
+    return QWidget::eventFilter(watched, event);
+}
+
+void TimestampPage::listZones()
+{
+    zonesListed_ = true;
+    const QStringList zones = TimeZone::names();
+    for (const Side* side : { &top_, &bottom_ }) {
+        // the zone shown stays, so nothing converts again
+        const QSignalBlocker b(side->zone);
+        const QString current = side->zone->currentText();
+        side->zone->clear();
+        side->zone->addItems(zones);
+        side->zone->setCurrentText(current);
+    }
+}
+
+bool TimestampPage::readFormat(const Side& side, TimestampFormat& format)
+{
+    format.style = static_cast<TimestampStyle>(side.style->currentData().toInt());
+    format.zone = TimeZone::utc();
+    if (format.style != TimestampStyle::Iso8601) return true;
+
+    QString error;
+    format.zone = TimeZone::find(side.zone->currentText().trimmed(), error);
+    if (!format.zone) status_->setText(error);
+    return format.zone != nullptr;
+}
+
+void TimestampPage::convert(bool fromBottom)
+{
+    bottomIsSource_ = fromBottom;
+    const Side& source = fromBottom ? bottom_ : top_;
+    const Side& target = fromBottom ? top_ : bottom_;
+
+    const QByteArray text = source.edit->text().trimmed().toUtf8();
+    if (text.isEmpty()) {
+        target.edit->clear();
+        return;
+    }
+    TimestampFormat from;
+    TimestampFormat to;
+    if (!readFormat(source, from) || !readFormat(target, to)) return;
+
+    TimeZone::Cursor fromZone(from.zone);
+    Instant t;
+    if (!parseTimestamp(text.constData(), text.constData() + text.size(), from.style, fromZone, t)) {
+        status_->setText(tr("Not a timestamp in %1.").arg(source.style->currentText()));
+        return;
+    }
+
+    char buf[kMaxTimestampChars];
+    TimeZone::Cursor toZone(to.zone);
+    const QString result = QString::fromLatin1(buf, formatTimestamp(t, to.style, toZone, buf) - buf);
+    if (target.edit->text() != result) {
+        const QSignalBlocker b(target.edit);
+        target.edit->setText(result);
+    }
+    // the instant itself, whatever the two sides show
+    TimeZone::Cursor utc(TimeZone::utc());
+    status_->setText(QString::fromLatin1(buf, formatTimestamp(t, TimestampStyle::Iso8601, utc, buf) - buf));
+}
+
+void TimestampPage::setNow()
+{
+    const qint64 ms = QDateTime::currentMSecsSinceEpoch();
+    const Instant now{ ms / 1000, std::int32_t(ms % 1000) * 1'000'000 }; // after 1970: no borrow
+
+    TimestampFormat format;
+    if (!readFormat(top_, format)) return;
+    TimeZone::Cursor zone(format.zone);
+    char buf[kMaxTimestampChars];
+    top_.edit->setText(QString::fromLatin1(buf, formatTimestamp(now, format.style, zone, buf) - buf));
+    convert(false);
+}
@@ -0,0 +1,46 @@
+#ifndef TIMESTAMPPAGE_H
+#define TIMESTAMPPAGE_H
+
+#include <QWidget>
+
+#include "timestamp.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+
+// The "Time Zones" tab: one instant as a Unix count or as ISO-8601 local time in any zone
+// of the system's tzdata, converted both ways as either side is edited.
+class TimestampPage : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit TimestampPage(QWidget *parent = nullptr);
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    struct Side {
+        QLineEdit* edit = nullptr;
+        QComboBox* style = nullptr;
+        QComboBox* zone = nullptr; // used by ISO-8601 only
+    };
+
+    Side top_;
+    Side bottom_;
+    QLabel* status_ = nullptr;
+    bool bottomIsSource_ = false; // the side edited last; format changes convert from it
+    bool zonesListed_ = false;
+
+    Side makeSide(TimestampStyle style, const QString& zone);
+    // Lists every zone in both combos; until a combo is first focused it holds only its own.
+    void listZones();
+    // The side's format; false with the reason in the status line for an unknown zone.
+    bool readFormat(const Side& side, TimestampFormat& format);
+    void convert(bool fromBottom);
+    void setNow();
+};
+
+#endif // TIMESTAMPPAGE_H
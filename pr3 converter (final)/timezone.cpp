@@ -0,0 +1,399 @@
+#include "timezone.h"
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <mutex>
+
+namespace {
+
+constexpr std::int64_t kSecondsPerDay = 86400;
+
+// Largest TZif file read; real ones are a few KiB.
+constexpr qint64 kMaxZoneFileBytes = 1 << 20;
+
+QString zoneDirectory()
+{
+    return qEnvironmentVariable("TZDIR", QStringLiteral("/usr/share/zoneinfo"));
+}
+
+// Names are relative paths of letters, digits and _+-, never leaving the directory.
+bool isZoneName(const QString& name)
+{
+    if (name.isEmpty() || name.startsWith(QLatin1Char('/')) || name.contains(QLatin1String("..")))
+        return false;
+    return std::all_of(name.begin(), name.end(), [](QChar c) {
+        return c.isLetterOrNumber() || c == QLatin1Char('/') || c == QLatin1Char('_') || c == QLatin1Char('+')
+            || c == QLatin1Char('-');
+    });
+}
+
+std::int64_t floorDiv(std::int64_t a, std::int64_t b)
+{
+    return a / b - (a % b != 0 && (a % b < 0) != (b < 0));
+}
+
+bool isLeapYear(std::int64_t y)
+{
+    return y % 4 == 0 && (y % 100 != 0 || y % 400 == 0);
+}
+
+std::uint32_t be32(const unsigned char* p)
+{
+    return std::uint32_t(p[0]) << 24 | std::uint32_t(p[1]) << 16 | std::uint32_t(p[2]) << 8 | p[3];
+}
+
+std::int64_t be64(const unsigned char* p)
+{
+    return std::int64_t(std::uint64_t(be32(p)) << 32 | be32(p + 4));
+}
+
+// TZ-string pieces, advancing p. Each returns false on malformed text.
+
+bool parseNumber(const char*& p, const char* end, int max, int& out)
+{
+    if (p == end || *p < '0' || *p > '9') return false;
+    out = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+        out = out * 10 + (*p - '0');
+        if (out > max) return false;
+    }
+    return true;
+}
+
+// [+-]hh[:mm[:ss]], hours up to 167 (RFC 8536 extends POSIX's 24 for rule times)
+bool parseDuration(const char*& p, const char* end, int& seconds)
+{
+    const bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+')) ++p;
+    int h = 0, m = 0, s = 0;
+    if (!parseNumber(p, end, 167, h)) return false;
+    if (p < end && *p == ':') {
+        ++p;
+        if (!parseNumber(p, end, 59, m)) return false;
+        if (p < end && *p == ':') {
+            ++p;
+            if (!parseNumber(p, end, 59, s)) return false;
+        }
+    }
+    seconds = (h * 3600 + m * 60 + s) * (negative ? -1 : 1);
+    return true;
+}
+
+// EST, or <+0330> for names with digits and signs
+bool skipZoneAbbreviation(const char*& p, const char* end)
+{
+    const char* start = p;
+    if (p < end && *p == '<') {
+        while (p < end && *p != '>') ++p;
+        if (p == end) return false;
+        ++p;
+        return p - start >= 5;
+    }
+    while (p < end && ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z'))) ++p;
+    return p - start >= 3;
+}
+
+} // namespace
+
+bool TimeZone::PosixRule::parse(const char* p, const char* textEnd)
+{
+    auto parseDate = [&](Date& d) {
+        int v = 0;
+        if (p < textEnd && *p == 'M') {
+            ++p;
+            d.kind = Date::Kind::MonthWeekDay;
+            if (!parseNumber(p, textEnd, 12, d.month) || d.month < 1 || p == textEnd || *p++ != '.') return false;
+            if (!parseNumber(p, textEnd, 5, d.week) || d.week < 1 || p == textEnd || *p++ != '.') return false;
+            if (!parseNumber(p, textEnd, 6, d.day)) return false;
+        } else if (p < textEnd && *p == 'J') {
+            ++p;
+            d.kind = Date::Kind::JulianNoLeap;
+            if (!parseNumber(p, textEnd, 365, v) || v < 1) return false;
+            d.day = v;
+        } else {
+            d.kind = Date::Kind::JulianZero;
+            if (!parseNumber(p, textEnd, 365, v)) return false;
+            d.day = v;
+        }
+        d.time = 7200;
+        return p == textEnd || *p != '/' || parseDuration(++p, textEnd, d.time);
+    };
+
+    // std offset [dst [offset] [,start[/time],end[/time]]]; offsets count hours west
+    int west = 0;
+    if (!skipZoneAbbreviation(p, textEnd) || !parseDuration(p, textEnd, west)) return false;
+    standardOffset = -west;
+    hasDst = p < textEnd;
+    if (!hasDst) return true;
+    if (!skipZoneAbbreviation(p, textEnd)) return false;
+    dstOffset = standardOffset + 3600;
+    if (p < textEnd && *p != ',') {
+        if (!parseDuration(p, textEnd, west)) return false;
+        dstOffset = -west;
+    }
+    if (p == textEnd) {
+        // no rule: the US one, as in glibc
+        start = { Date::Kind::MonthWeekDay, 0, 2, 3, 7200 };
+        end = { Date::Kind::MonthWeekDay, 0, 1, 11, 7200 };
+        return true;
+    }
+    if (*p++ != ',' || !parseDate(start) || p == textEnd || *p++ != ',' || !parseDate(end)) return false;
+    return p == textEnd;
+}
+
+std::shared_ptr<const TimeZone> TimeZone::utc()
+{
+    static const std::shared_ptr<const TimeZone> zone = [] {
+        auto z = std::make_shared<TimeZone>();
+        z->name_ = QStringLiteral("UTC");
+        z->offsets_ = { 0 };
+        return std::shared_ptr<const TimeZone>(std::move(z));
+    }();
+    return zone;
+}
+
+std::shared_ptr<const TimeZone> TimeZone::find(const QString& name, QString& error)
+{
+    static std::mutex mutex;
+    static QHash<QString, std::shared_ptr<const TimeZone>> cache;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (const auto it = cache.constFind(name); it != cache.constEnd()) return *it;
+
+    if (!isZoneName(name)) {
+        error = QStringLiteral("'%1' is not a time zone name").arg(name);
+        return nullptr;
+    }
+    QFile file(zoneDirectory() + QLatin1Char('/') + name);
+    if (!file.open(QIODevice::ReadOnly) || file.size() > kMaxZoneFileBytes) {
+        // UTC works without tzdata too
+        if (name == QLatin1String("UTC")) return utc();
+        error = QStringLiteral("unknown time zone '%1'").arg(name);
+        return nullptr;
+    }
+    auto zone = std::make_shared<TimeZone>();
+    zone->name_ = name;
+    if (!zone->load(file.readAll(), error)) {
+        error = name + QStringLiteral(": ") + error;
+        return nullptr;
+    }
+    cache.insert(name, zone);
+    return zone;
+}
+
+QStringList TimeZone::names()
+{
+    // zone files and links sit under capitalized names; only those directories are walked,
+    // so posix/ and right/ (another copy of every zone each), localtime, posixrules and the
+    // *.tab / *.zi indexes are never listed
+    QStringList names;
+    const auto walk = [&names](const auto& self, const QDir& dir, const QString& prefix) -> void {
+        auto zoneEntry = [](const QString& entry) {
+            return entry.at(0).isUpper() && !entry.contains(QLatin1Char('.'));
+        };
+        for (const QString& entry : dir.entryList(QDir::Files)) {
+            if (zoneEntry(entry) && isZoneName(prefix + entry)) names.append(prefix + entry);
+        }
+        for (const QString& entry : dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot)) {
+            if (zoneEntry(entry)) self(self, QDir(dir.filePath(entry)), prefix + entry + QLatin1Char('/'));
+        }
+    };
+    walk(walk, QDir(zoneDirectory()), QString());
+    names.sort();
+    return names;
+}
+
+bool TimeZone::load(const QByteArray& data, QString& error)
+{
+    const auto* const bytes = reinterpret_cast<const unsigned char*>(data.constData());
+    const std::size_t size = std::size_t(data.size());
+
+    constexpr std::size_t kHeaderBytes = 44;
+    struct Counts {
+        std::uint32_t isUt, isStd, leap, time, type, chars;
+    };
+    auto readHeader = [&](std::size_t at, Counts& c) {
+        if (size < at + kHeaderBytes || std::memcmp(bytes + at, "TZif", 4) != 0) return false;
+        const unsigned char* p = bytes + at + 20;
+        c = { be32(p), be32(p + 4), be32(p + 8), be32(p + 12), be32(p + 16), be32(p + 20) };
+        // bounded by the file size, so the sums below cannot overflow
+        return c.type >= 1 && c.type <= 256 && c.time <= size && c.chars <= size && c.leap <= size
+            && c.isStd <= size && c.isUt <= size;
+    };
+    auto bodyBytes = [](const Counts& c, std::size_t timeBytes) {
+        return c.time * (timeBytes + 1) + c.type * 6 + c.chars + c.leap * (timeBytes + 4) + c.isStd + c.isUt;
+    };
+
+    Counts counts{};
+    if (!readHeader(0, counts)) {
+        error = QStringLiteral("not a TZif file");
+        return false;
+    }
+    // version 2 and later repeat the data with 64-bit times, then add the TZ string
+    std::size_t at = kHeaderBytes;
+    std::size_t timeBytes = 4;
+    if (bytes[4] >= '2') {
+        at += bodyBytes(counts, 4);
+        if (!readHeader(at, counts)) {
+            error = QStringLiteral("truncated TZif file");
+            return false;
+        }
+        at += kHeaderBytes;
+        timeBytes = 8;
+    }
+    if (size < at + bodyBytes(counts, timeBytes)) {
+        error = QStringLiteral("truncated TZif file");
+        return false;
+    }
+
+    const unsigned char* times = bytes + at;
+    const unsigned char* typeIndexes = times + counts.time * timeBytes;
+    const unsigned char* types = typeIndexes + counts.time;
+    auto typeOffset = [&](std::size_t type) { return std::int32_t(be32(types + type * 6)); };
+
+    transitions_.clear();
+    offsets_.assign(1, typeOffset(0));
+    for (std::size_t i = 0; i < counts.time; ++i) {
+        const std::int64_t t = timeBytes == 8 ? be64(times + i * 8) : std::int32_t(be32(times + i * 4));
+        if (typeIndexes[i] >= counts.type || (!transitions_.empty() && t <= transitions_.back())) {
+            error = QStringLiteral("bad transition %1").arg(qulonglong(i));
+            return false;
+        }
+        const std::int32_t offset = typeOffset(typeIndexes[i]);
+        if (offset == offsets_.back()) continue; // a rename only
+        transitions_.push_back(t);
+        offsets_.push_back(offset);
+    }
+
+    rule_ = PosixRule{};
+    rule_.standardOffset = offsets_.back();
+    const std::size_t footer = at + bodyBytes(counts, timeBytes);
+    if (timeBytes == 8 && footer < size && bytes[footer] == '\n') {
+        const char* begin = data.constData() + footer + 1;
+        const char* end = static_cast<const char*>(std::memchr(begin, '\n', size - footer - 1));
+        if (!end) {
+            error = QStringLiteral("unterminated TZ string");
+            return false;
+        }
+        if (end > begin && !rule_.parse(begin, end)) {
+            error = QStringLiteral("bad TZ string '%1'").arg(QString::fromLatin1(begin, end - begin));
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t TimeZone::transitionsUpTo(std::int64_t utc, std::size_t hint) const
+{
+    const std::size_t n = transitions_.size();
+    hint = std::min(hint, n);
+    // sorted input moves at most a step or two at a time
+    for (int step = 0; step < 4; ++step) {
+        if (hint < n && transitions_[hint] <= utc) ++hint;
+        else if (hint > 0 && transitions_[hint - 1] > utc) --hint;
+        else return hint;
+    }
+    return std::size_t(std::upper_bound(transitions_.begin(), transitions_.end(), utc) - transitions_.begin());
+}
+
+TimeZone::Span TimeZone::spanFrom(std::int64_t utc, std::size_t count) const
+{
+    Span span;
+    if (count > 0) span.begin = transitions_[count - 1];
+    if (count < transitions_.size()) {
+        span.end = transitions_[count];
+        span.offset = offsets_[count];
+        return span;
+    }
+    if (!rule_.hasDst) {
+        span.offset = transitions_.empty() ? rule_.standardOffset : offsets_.back();
+        return span;
+    }
+    const Span r = ruleSpan(utc);
+    span.begin = std::max(span.begin, r.begin);
+    span.end = r.end;
+    span.offset = r.offset;
+    return span;
+}
+
+TimeZone::Span TimeZone::spanAt(std::int64_t utc) const
+{
+    return spanFrom(utc, transitionsUpTo(utc, transitions_.size()));
+}
+
+TimeZone::Span TimeZone::ruleSpan(std::int64_t utc) const
+{
+    auto localSeconds = [](const PosixRule::Date& d, std::int64_t year) {
+        std::int64_t day = daysFromCivil(year, 1, 1);
+        switch (d.kind) {
+        case PosixRule::Date::Kind::JulianNoLeap:
+            day += d.day - 1 + (isLeapYear(year) && d.day >= 60);
+            break;
+        case PosixRule::Date::Kind::JulianZero:
+            day += d.day;
+            break;
+        case PosixRule::Date::Kind::MonthWeekDay: {
+            const std::int64_t first = daysFromCivil(year, d.month, 1);
+            const std::int64_t next = d.month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, d.month + 1, 1);
+            const std::int64_t weekday = ((first + 4) % 7 + 7) % 7; // 1970-01-01 was a Thursday
+            day = first + (d.day - weekday + 7) % 7 + (d.week - 1) * 7;
+            while (day >= next) day -= 7; // week 5: the last one
+            break;
+        }
+        }
+        return day * kSecondsPerDay + d.time;
+    };
+
+    // this year's changes and the neighbours', so spans crossing New Year are whole
+    std::int64_t year = 0;
+    int month = 0, day = 0;
+    civilFromDays(floorDiv(utc + rule_.standardOffset, kSecondsPerDay), year, month, day);
+    struct Change {
+        std::int64_t at;
+        std::int32_t offset;
+    };
+    std::array<Change, 6> changes;
+    for (int i = 0; i < 3; ++i) {
+        changes[std::size_t(2 * i)] = { localSeconds(rule_.start, year - 1 + i) - rule_.standardOffset, rule_.dstOffset };
+        changes[std::size_t(2 * i + 1)] = { localSeconds(rule_.end, year - 1 + i) - rule_.dstOffset, rule_.standardOffset };
+    }
+    std::sort(changes.begin(), changes.end(), [](const Change& a, const Change& b) { return a.at < b.at; });
+
+    Span span;
+    span.offset = changes.front().offset == rule_.dstOffset ? rule_.standardOffset : rule_.dstOffset;
+    for (const Change& c : changes) {
+        if (c.at > utc) {
+            span.end = c.at;
+            break;
+        }
+        span.begin = c.at;
+        span.offset = c.offset;
+    }
+    return span;
+}
+
+TimeZone::Cursor::Cursor(std::shared_ptr<const TimeZone> zone)
+    : zone_(std::move(zone))
+{
+    // empty, so the first lookup fills it
+    span_.begin = span_.end = 0;
+}
+
+std::int64_t TimeZone::Cursor::toUtc(std::int64_t local)
+{
+    // the offsets in force a day either side; clocks never change twice within two days
+    const std::int32_t before = offsetAt(local - kSecondsPerDay);
+    const std::int32_t after = offsetAt(local + kSecondsPerDay);
+    if (before == after) return local - before;
+
+    const bool beforeValid = offsetAt(local - before) == before;
+    const bool afterValid = offsetAt(local - after) == after;
+    if (beforeValid && afterValid) return std::min(local - before, local - after);
+    if (afterValid) return local - after;
+    return local - before; // valid, or in the gap
+}
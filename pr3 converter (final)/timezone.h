@@ -0,0 +1,127 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+// Days from 1970-01-01 to a date of the proleptic Gregorian calendar, and back; month 1..12.
+// Exact for any year an int64 of seconds can reach (H. Hinnant's algorithms).
+constexpr std::int64_t daysFromCivil(std::int64_t year, int month, int day)
+{
+    year -= month <= 2;
+    const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const std::int64_t yearOfEra = year - era * 400;
+    const std::int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const std::int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+constexpr void civilFromDays(std::int64_t days, std::int64_t& year, int& month, int& day)
+{
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const std::int64_t dayOfEra = days - era * 146097;
+    const std::int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const std::int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const std::int64_t mp = (5 * dayOfYear + 2) / 153;
+    day = int(dayOfYear - (153 * mp + 2) / 5 + 1);
+    month = int(mp < 10 ? mp + 3 : mp - 9);
+    year = yearOfEra + era * 400 + (month <= 2);
+}
+
+// A zone's UTC offsets over time, read from its TZif file (RFC 8536) in the system zoneinfo
+// directory ($TZDIR, else /usr/share/zoneinfo). Times are POSIX seconds; leap seconds are
+// ignored, as everywhere else.
+//
+// The file is compacted on load into one ascending array of the instants the UTC offset
+// changes, with the offset that follows each; transitions that only rename the zone (EST
+// to CST at the same offset) are dropped. Past the last transition the file's POSIX rule
+// (EST5EDT,M3.2.0,M11.1.0) gives each year's changes arithmetically, so any year works.
+class TimeZone
+{
+public:
+    struct Span {
+        std::int64_t begin = std::numeric_limits<std::int64_t>::min(); // first UTC second
+        std::int64_t end = std::numeric_limits<std::int64_t>::max();   // one past the last
+        std::int32_t offset = 0;                                      // seconds east of UTC
+    };
+
+    // The zone called name ("Europe/Paris", "UTC"), loaded once and then shared; null with
+    // error set if there is no such zone or its file is malformed. Thread-safe.
+    static std::shared_ptr<const TimeZone> find(const QString& name, QString& error);
+    static std::shared_ptr<const TimeZone> utc();
+
+    // Every zone name in the zoneinfo directory, sorted.
+    static QStringList names();
+
+    const QString& name() const { return name_; }
+    bool isUtc() const { return transitions_.empty() && !rule_.hasDst && rule_.standardOffset == 0; }
+
+    // The stretch of time around utc with one offset. O(log transitions).
+    Span spanAt(std::int64_t utc) const;
+    std::int32_t offsetAt(std::int64_t utc) const { return spanAt(utc).offset; }
+
+    // Remembers the last span, so runs of sorted or nearby timestamps are O(1) amortized:
+    // a lookup inside the span is two compares, one in the next span a single step.
+    class Cursor
+    {
+    public:
+        explicit Cursor(std::shared_ptr<const TimeZone> zone);
+
+        const TimeZone& zone() const { return *zone_; }
+        std::int32_t offsetAt(std::int64_t utc)
+        {
+            if (utc < span_.begin || utc >= span_.end) {
+                count_ = zone_->transitionsUpTo(utc, count_);
+                span_ = zone_->spanFrom(utc, count_);
+            }
+            return span_.offset;
+        }
+
+        // The UTC second of a local wall-clock second. A time repeated when clocks go back
+        // takes its first (earlier) instant; a time skipped when they go forward is read
+        // with the offset before the change, so 02:30 in a 02:00 -> 03:00 gap is 03:30.
+        std::int64_t toUtc(std::int64_t local);
+
+    private:
+        std::shared_ptr<const TimeZone> zone_;
+        Span span_;
+        std::size_t count_ = 0; // transitions up to span_
+    };
+
+private:
+    // TZ-string rule for the times after the last transition (POSIX.1-2017 8.3).
+    struct PosixRule {
+        struct Date {
+            enum class Kind : std::uint8_t { JulianNoLeap, JulianZero, MonthWeekDay };
+            Kind kind = Kind::MonthWeekDay;
+            int day = 0;        // Jn: 1..365; n: 0..365; Mm.w.d: weekday 0 (Sunday)..6
+            int week = 0;       // Mm.w.d: 1..5, 5 meaning the last
+            int month = 0;      // Mm.w.d: 1..12
+            int time = 7200;    // local seconds after midnight (may be negative or past 24h)
+        };
+        std::int32_t standardOffset = 0; // seconds east of UTC
+        std::int32_t dstOffset = 0;
+        bool hasDst = false;
+        Date start; // into DST, in standard time
+        Date end;   // out of DST, in DST
+
+        bool parse(const char* text, const char* textEnd);
+    };
+
+    QString name_;
+    std::vector<std::int64_t> transitions_; // UTC seconds, ascending
+    std::vector<std::int32_t> offsets_;     // offsets_[i + 1] from transitions_[i]; offsets_[0] before the first
+    PosixRule rule_;
+
+    bool load(const QByteArray& data, QString& error);
+    // How many transitions are at or before utc, stepping from hint (an earlier answer)
+    // before falling back to a binary search.
+    std::size_t transitionsUpTo(std::int64_t utc, std::size_t hint) const;
+    // The span of utc, given transitionsUpTo(utc).
+    Span spanFrom(std::int64_t utc, std::size_t count) const;
+    Span ruleSpan(std::int64_t utc) const;
+};
@@ -0,0 +1,432 @@
+#include "unitexpr.h"
+#include "batchkernels.h"
+#include "converter.h"
+#include "derivedunit.h"
+#include "unitindex.h"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// Recursive descent over
+//
+//     sum      := product (('+' | '-') product)*
+//     product  := unary (('*' | '/') unary)*
+//     unary    := '-' unary | '+' unary | primary
+//     primary  := quantity+ | '(' sum ')' [unit]
+//     quantity := (number | 'x') [unit]
+//
+// Every subexpression is a Value: either still folded (a * x + b, with a == 0 for constants)
+// or already emitted as bytecode, whose result is then on top of the evaluator's stack.
+class ExprCompiler
+{
+public:
+    ExprCompiler(std::string_view text, UnitExpression& out) : text_(text), out_(out) {}
+
+    ExprError run(std::size_t& errorPos)
+    {
+        Value v;
+        if (!sum(v)) {
+            errorPos = pos_;
+            return error_;
+        }
+        // whatever sum() stopped at must be the end: "1 + 2 ) * 1000", "12 ft (in m)"
+        skipSpace();
+        if (pos_ != text_.size()) {
+            fail(ExprError::Syntax);
+            errorPos = pos_;
+            return error_;
+        }
+        out_.hasDimension_ = v.hasDimension;
+        out_.mode_ = v.mode;
+        if (v.folded) {
+            out_.code_.clear();
+            out_.affine_ = { v.a, v.b };
+            out_.usesInput_ = v.a != 0.0;
+            out_.unit_ = v.unit;
+            out_.unitAffine_ = v.unitAffine;
+        }
+        return ExprError::None;
+    }
+
+private:
+    struct Value {
+        bool folded = true;
+        double a = 0.0;
+        double b = 0.0;
+        bool hasDimension = false;
+        UnitMode mode = UnitMode::Length;
+        bool offsetUnit = false; // a lone quantity in C or F; may not be combined
+        UnitId unit = UnitId::Invalid; // see UnitExpression::unit()
+        Affine unitAffine;
+    };
+
+    using Op = UnitExpression::Op;
+
+    std::string_view text_;
+    UnitExpression& out_;
+    std::size_t pos_ = 0;
+    std::size_t depth_ = 0; // evaluator stack depth after the code emitted so far
+    ExprError error_ = ExprError::None;
+
+    bool fail(ExprError e)
+    {
+        if (error_ == ExprError::None) error_ = e;
+        return false;
+    }
+
+    void skipSpace()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t')) ++pos_;
+    }
+
+    char peek()
+    {
+        skipSpace();
+        return pos_ < text_.size() ? text_[pos_] : '\0';
+    }
+
+    static bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // Unit words run until a blank, an operator or a parenthesis; see unit() for '/' and digits.
+    static bool isUnitChar(char c)
+    {
+        return c != ' ' && c != '\t' && c != '+' && c != '-' && c != '*' && c != '(' && c != ')' && c != '\0';
+    }
+
+    bool startsNumber()
+    {
+        const char c = peek();
+        if (isDigit(c)) return true;
+        if (c == '.') return pos_ + 1 < text_.size() && isDigit(text_[pos_ + 1]);
+        return c == 'x' && (pos_ + 1 == text_.size() || !isUnitChar(text_[pos_ + 1]) || text_[pos_ + 1] == '/');
+    }
+
+    bool startsUnit()
+    {
+        const char c = peek();
+        return isUnitChar(c) && c != '/' && !isDigit(c) && c != '.';
+    }
+
+    bool emit(Op op, double a = 0.0, double b = 0.0)
+    {
+        if (op == Op::Push || op == Op::Input) {
+            if (++depth_ > UnitExpression::kMaxStack) return fail(ExprError::TooComplex);
+        } else if (op != Op::Affine && op != Op::Neg) {
+            --depth_;
+        }
+        out_.code_.push_back({ op, a, b });
+        return true;
+    }
+
+    // Puts a folded value on the stack.
+    bool materialize(Value& v)
+    {
+        if (!v.folded) return true;
+        v.folded = false;
+        if (v.a == 0.0) return emit(Op::Push, v.b);
+        out_.usesInput_ = true;
+        if (!emit(Op::Input)) return false;
+        return (v.a == 1.0 && v.b == 0.0) || emit(Op::Affine, v.a, v.b);
+    }
+
+    // A unit as the compiler uses it: how to get to its mode's base unit.
+    struct UnitRef {
+        UnitMode mode = UnitMode::Length;
+        Affine toBase;
+        UnitId id = UnitId::Invalid; // Invalid for compound units
+    };
+
+    // v in `unit` -> v in the mode's base unit. v must not have a dimension yet.
+    bool applyUnit(Value& v, const UnitRef& unit)
+    {
+        if (v.hasDimension) return fail(ExprError::DimensionMismatch);
+        const Affine& c = unit.toBase;
+        v.hasDimension = true;
+        v.mode = unit.mode;
+        v.offsetUnit = c.offset != 0.0;
+        if (!v.folded) return emit(Op::Affine, c.scale, c.offset);
+        v.unit = unit.id;
+        v.unitAffine = { v.a, v.b };
+        v.a *= c.scale;
+        v.b = c.apply(v.b);
+        return true;
+    }
+
+    bool unit(UnitRef& unit)
+    {
+        skipSpace();
+        std::size_t end = pos_;
+        while (end < text_.size() && isUnitChar(text_[end])) ++end;
+
+        // The longest prefix that names a unit, cut before a '/' or a number, so "m/2" and
+        // "5ft3in" still read as expected while "km/h" and "cm2" stay whole. The whole word
+        // may also be a compound unit of some mode ("mi/h", "N·m", see derivedunit.h).
+        for (const std::size_t full = end; end > pos_; --end) {
+            if (end != full && text_[end] != '/' && !(isDigit(text_[end]) && !isDigit(text_[end - 1])))
+                continue;
+            const std::string_view word = text_.substr(pos_, end - pos_);
+            const UnitId id = exactUnitName(word);
+            if (isValidUnit(id)) {
+                const UnitMode mode = unitInfo(id).mode;
+                unit = { mode, Converter::coefficients(id, baseUnit(mode)), id };
+                pos_ = end;
+                return true;
+            }
+            DerivedUnit derived;
+            if (end == full && DerivedUnit::parse(word, derived) == DerivedUnitError::None && derived.mode()) {
+                unit = { *derived.mode(), { derived.scale(), 0.0 }, UnitId::Invalid };
+                pos_ = end;
+                return true;
+            }
+        }
+        return fail(ExprError::UnknownUnit);
+    }
+
+    bool optionalUnit(Value& v)
+    {
+        if (!startsUnit()) return true;
+        UnitRef u;
+        return unit(u) && applyUnit(v, u);
+    }
+
+    // The sign is applied to the number, before its unit: "-40 F" is minus forty Fahrenheit.
+    bool quantity(Value& v, bool negative)
+    {
+        v = {};
+        skipSpace();
+        if (text_[pos_] == 'x') {
+            ++pos_;
+            v.a = negative ? -1.0 : 1.0;
+        } else {
+            const auto r = std::from_chars(text_.data() + pos_, text_.data() + text_.size(), v.b);
+            if (r.ec != std::errc()) return fail(ExprError::Syntax);
+            pos_ = std::size_t(r.ptr - text_.data());
+            if (negative) v.b = -v.b;
+        }
+        return optionalUnit(v);
+    }
+
+    bool primary(Value& v, bool negative)
+    {
+        if (peek() == '(') {
+            ++pos_;
+            if (!sum(v)) return false;
+            if (peek() != ')') return fail(ExprError::Syntax);
+            ++pos_;
+            return (!negative || negate(v)) && optionalUnit(v);
+        }
+        if (!startsNumber()) return fail(ExprError::Syntax);
+        if (!quantity(v, negative)) return false;
+
+        // "5 ft 3 in": adjacent quantities add up; each needs a unit
+        while (startsNumber()) {
+            if (!v.hasDimension) return fail(ExprError::Syntax);
+            Value next;
+            if (!quantity(next, negative)) return false;
+            if (!next.hasDimension) return fail(ExprError::Syntax);
+            if (!binary('+', v, next)) return false;
+        }
+        return true;
+    }
+
+    bool unary(Value& v)
+    {
+        const char c = peek();
+        if (c != '-' && c != '+') return primary(v, false);
+        ++pos_;
+        if (peek() == '(' || startsNumber()) return primary(v, c == '-');
+        return unary(v) && (c == '+' || negate(v));
+    }
+
+    bool negate(Value& v)
+    {
+        if (v.offsetUnit) return fail(ExprError::OffsetUnit);
+        v.unit = UnitId::Invalid;
+        if (v.folded) {
+            v.a = -v.a;
+            v.b = -v.b;
+            return true;
+        }
+        return emit(Op::Neg);
+    }
+
+    bool binary(char op, Value& l, Value& r)
+    {
+        if (l.offsetUnit || r.offsetUnit) return fail(ExprError::OffsetUnit);
+
+        Value result;
+        switch (op) {
+        case '+':
+        case '-':
+            if (l.hasDimension != r.hasDimension || (l.hasDimension && l.mode != r.mode))
+                return fail(ExprError::DimensionMismatch);
+            result.hasDimension = l.hasDimension;
+            result.mode = l.mode;
+            break;
+        case '*':
+            if (l.hasDimension && r.hasDimension) return fail(ExprError::DimensionMismatch);
+            result.hasDimension = l.hasDimension || r.hasDimension;
+            result.mode = l.hasDimension ? l.mode : r.mode;
+            break;
+        default: // '/'
+            if (r.hasDimension && !(l.hasDimension && l.mode == r.mode))
+                return fail(ExprError::DimensionMismatch);
+            result.hasDimension = l.hasDimension && !r.hasDimension;
+            result.mode = l.mode;
+            break;
+        }
+
+        // Fold while both sides are affine in x and the result stays affine.
+        if (l.folded && r.folded) {
+            bool folds = true;
+            switch (op) {
+            case '+': result.a = l.a + r.a; result.b = l.b + r.b; break;
+            case '-': result.a = l.a - r.a; result.b = l.b - r.b; break;
+            case '*':
+                if (l.a == 0.0) { result.a = l.b * r.a; result.b = l.b * r.b; }
+                else if (r.a == 0.0) { result.a = l.a * r.b; result.b = l.b * r.b; }
+                else folds = false;
+                break;
+            default:
+                if (r.a == 0.0) { result.a = l.a / r.b; result.b = l.b / r.b; }
+                else folds = false;
+                break;
+            }
+            if (folds) {
+                // scaling by a plain constant keeps the unit: "2 * x mi", "x mi / 2"
+                if (op == '*' && l.a == 0.0 && !l.hasDimension && r.unit != UnitId::Invalid) {
+                    result.unit = r.unit;
+                    result.unitAffine = { r.unitAffine.scale * l.b, r.unitAffine.offset * l.b };
+                } else if (op != '+' && op != '-' && r.a == 0.0 && !r.hasDimension && l.unit != UnitId::Invalid) {
+                    result.unit = l.unit;
+                    result.unitAffine = op == '*' ? Affine{ l.unitAffine.scale * r.b, l.unitAffine.offset * r.b }
+                                                  : Affine{ l.unitAffine.scale / r.b, l.unitAffine.offset / r.b };
+                }
+                l = result;
+                return true;
+            }
+        }
+
+        // Otherwise both operands go on the stack. A folded left operand is pushed after an
+        // already emitted right one, so the reversed operator is used.
+        const bool reversed = l.folded && !r.folded;
+        if (!materialize(l) || !materialize(r)) return false;
+        Op code;
+        switch (op) {
+        case '+': code = Op::Add; break;
+        case '-': code = reversed ? Op::SubFrom : Op::Sub; break;
+        case '*': code = Op::Mul; break;
+        default:  code = reversed ? Op::DivInto : Op::Div; break;
+        }
+        if (!emit(code)) return false;
+        result.folded = false;
+        l = result;
+        return true;
+    }
+
+    bool product(Value& v)
+    {
+        if (!unary(v)) return false;
+        for (char c = peek(); c == '*' || c == '/'; c = peek()) {
+            ++pos_;
+            Value r;
+            if (!unary(r) || !binary(c, v, r)) return false;
+        }
+        return true;
+    }
+
+    bool sum(Value& v)
+    {
+        if (!product(v)) return false;
+        for (char c = peek(); c == '+' || c == '-'; c = peek()) {
+            ++pos_;
+            Value r;
+            if (!product(r) || !binary(c, v, r)) return false;
+        }
+        return true;
+    }
+};
+
+ExprError UnitExpression::compile(std::string_view text, UnitExpression& out, std::size_t* errorPos)
+{
+    out = UnitExpression();
+    std::size_t pos = 0;
+    const ExprError e = ExprCompiler(text, out).run(pos);
+    if (e != ExprError::None) {
+        out = UnitExpression();
+        if (errorPos) *errorPos = pos;
+    }
+    return e;
+}
+
+namespace {
+
+struct TextHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view s) const noexcept { return std::hash<std::string_view>()(s); }
+};
+
+// Plenty for interactive use; on overflow the cache simply starts over.
+constexpr std::size_t kMaxCachedExpressions = 1024;
+
+} // namespace
+
+std::shared_ptr<const UnitExpression> UnitExpression::compileCached(std::string_view text, ExprError& error)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const UnitExpression>, TextHash, std::equal_to<>> cache;
+
+    {
+        const std::lock_guard<std::mutex> lock(mutex);
+        if (const auto it = cache.find(text); it != cache.end()) {
+            error = ExprError::None;
+            return it->second;
+        }
+    }
+
+    auto compiled = std::make_shared<UnitExpression>();
+    error = compile(text, *compiled);
+    if (error != ExprError::None) return nullptr;
+
+    const std::lock_guard<std::mutex> lock(mutex);
+    if (cache.size() >= kMaxCachedExpressions) cache.clear();
+    cache.emplace(std::string(text), compiled);
+    return compiled;
+}
+
+double UnitExpression::evaluate(double x) const noexcept
+{
+    if (code_.empty()) return affine_.apply(x);
+
+    double stack[kMaxStack];
+    std::size_t n = 0;
+    for (const Instr& in : code_) {
+        switch (in.op) {
+        case Op::Push:    stack[n++] = in.a; break;
+        case Op::Input:   stack[n++] = x; break;
+        case Op::Affine:  stack[n - 1] = std::fma(stack[n - 1], in.a, in.b); break;
+        case Op::Neg:     stack[n - 1] = -stack[n - 1]; break;
+        case Op::Add:     --n; stack[n - 1] = stack[n - 1] + stack[n]; break;
+        case Op::Sub:     --n; stack[n - 1] = stack[n - 1] - stack[n]; break;
+        case Op::Mul:     --n; stack[n - 1] = stack[n - 1] * stack[n]; break;
+        case Op::Div:     --n; stack[n - 1] = stack[n - 1] / stack[n]; break;
+        case Op::SubFrom: --n; stack[n - 1] = stack[n] - stack[n - 1]; break;
+        case Op::DivInto: --n; stack[n - 1] = stack[n] / stack[n - 1]; break;
+        }
+    }
+    return stack[0];
+}
+
+void UnitExpression::evaluate(std::span<const double> x, std::span<double> out) const noexcept
+{
+    const std::size_t n = std::min(x.size(), out.size());
+    if (code_.empty()) {
+        affineBatch(x.data(), out.data(), n, affine_.scale, affine_.offset);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i) out[i] = evaluate(x[i]);
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+#include "affine.h"
+#include "unitregistry.h"
+
+enum class ExprError : std::uint8_t {
+    None,
+    Syntax,            // unexpected character or missing operand / parenthesis
+    UnknownUnit,
+    DimensionMismatch, // "2 m + 3 kg", "2 m * 3 ft", "1 / 2 s"
+    OffsetUnit,        // arithmetic on a unit with an offset, such as "20 C + 5 C"
+    TooComplex         // nested deeper than the evaluator's stack
+};
+
+// Arithmetic over quantities, compiled once and evaluated for many inputs:
+//
+//     5 ft 3 in + 2 m        (3 lb + 4 oz) * 12        x mi / 2        -40 F
+//
+// A number (or x, the input value) directly followed by a unit is a quantity, and adjacent
+// quantities add up ("5 ft 3 in"); a unit after a parenthesised plain number applies to it.
+// Units are catalogue keys or aliases, matched case-insensitively when that is unambiguous,
+// or compound units with a mode's dimensions written without blanks ("mi/h", "N·m").
+// + - * / follow the usual precedence. Sums need one dimension throughout; products allow
+// at most one dimensioned factor, and a quotient of two equal dimensions is a plain number.
+// Units with an offset (C, F) convert only a lone number; they take no part in arithmetic.
+//
+// Compiling converts every quantity to its mode's base unit (unit factors become constants)
+// and folds constants. An expression affine in x, which covers sums, scaling and every unit
+// conversion, folds all the way to one Affine and is evaluated by the SIMD batch kernels;
+// anything else (x * x, 1 / x) is kept as compact stack bytecode.
+class UnitExpression
+{
+public:
+    // On failure, errorPos (if given) receives the byte offset the error was detected at.
+    static ExprError compile(std::string_view text, UnitExpression& out, std::size_t* errorPos = nullptr);
+
+    // compile() behind a process-wide cache keyed by the text; thread-safe. Failures are not cached.
+    static std::shared_ptr<const UnitExpression> compileCached(std::string_view text, ExprError& error);
+
+    // False for a plain number; otherwise results are in baseUnit(mode()).
+    bool hasDimension() const { return hasDimension_; }
+    UnitMode mode() const { return mode_; }
+    bool usesInput() const { return usesInput_; }
+
+    // Set when the whole expression is one unit applied to a plain affine form of x, perhaps
+    // multiplied or divided by plain numbers ("x F", "-40 F", "2 * x mi", "x mi / 2"): the
+    // result is then unitAffine() applied to x, in unit(). Converter uses it to go straight
+    // to the target unit with the fused coefficients.
+    UnitId unit() const { return unit_; }
+    const Affine& unitAffine() const { return unitAffine_; }
+
+    // True when the expression folded to result = x * affine().scale + affine().offset.
+    bool isAffine() const { return code_.empty(); }
+    const Affine& affine() const { return affine_; }
+
+    double evaluate(double x = 0.0) const noexcept;
+
+    // out[i] = evaluate(x[i]); out must be at least as long as x (they may be the same buffer).
+    void evaluate(std::span<const double> x, std::span<double> out) const noexcept;
+
+private:
+    friend class ExprCompiler;
+
+    // Stack machine; s is the value below the top t. SubFrom and DivInto are t - s and t / s,
+    // for operands that were pushed in the opposite order.
+    enum class Op : std::uint8_t { Push, Input, Affine, Add, Sub, Mul, Div, SubFrom, DivInto, Neg };
+
+    struct Instr {
+        Op op;
+        double a = 0.0; // Push value, Affine scale
+        double b = 0.0; // Affine offset
+    };
+
+    static constexpr std::size_t kMaxStack = 32;
+
+    std::vector<Instr> code_;
+    Affine affine_;
+    Affine unitAffine_;
+    UnitId unit_ = UnitId::Invalid;
+    UnitMode mode_ = UnitMode::Length;
+    bool hasDimension_ = false;
+    bool usesInput_ = false;
+};
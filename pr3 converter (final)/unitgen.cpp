@@ -0,0 +1,562 @@
+// unitgen: compiles units.catalog into the registry tables that unitregistry.h and
+// converter.cpp include. It runs at build time (see CMakeLists.txt) and has no Qt
+// dependency, so the catalogue is parsed once per build rather than once per start.
+//
+//     unitgen <units.catalog> <output directory>
+//
+// Writes unitcatalog_ids.inc (UnitMode, UnitId), unitcatalog_tables.inc (kUnits and the
+// name hash) and unitcatalog_affine.inc (the fused per-mode conversion tables). Files whose
+// content did not change are left alone so dependants do not rebuild.
+#include "affine.h"
+#include "unithash.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+// Base dimensions for dim=: length, mass, time, temperature, data (bytes) and angle.
+constexpr std::string_view kBaseDimensions = "LMTKBA";
+
+struct Unit {
+    std::string ident;
+    std::string key;
+    std::string name;
+    std::vector<std::string> aliases;
+    std::size_t mode = 0;
+    Ratio scale{ 1.0 };
+    Ratio offset{ 0.0 };
+};
+
+struct Mode {
+    std::string ident;
+    std::string name;
+    std::size_t first = 0;
+    std::size_t count = 0;
+    std::size_t base = 0; // unit with scale 1 and no offset
+    std::vector<int> dims; // exponent of each kBaseDimensions symbol
+};
+
+struct Catalog {
+    std::vector<Mode> modes;
+    std::vector<Unit> units;
+};
+
+// Splits a catalogue line into words; "quoted text" is one word, '#' starts a comment.
+bool tokenize(const std::string& line, std::vector<std::string>& words, std::string& error)
+{
+    words.clear();
+    std::size_t i = 0;
+    while (i < line.size()) {
+        const char c = line[i];
+        if (c == ' ' || c == '\t' || c == '\r') { ++i; continue; }
+        if (c == '#') break;
+        if (c == '"') {
+            const std::size_t end = line.find('"', i + 1);
+            if (end == std::string::npos) { error = "unterminated string"; return false; }
+            words.push_back(line.substr(i, end + 1 - i));
+            i = end + 1;
+            continue;
+        }
+        std::size_t end = i;
+        while (end < line.size() && line[end] != ' ' && line[end] != '\t' && line[end] != '\r')
+            ++end;
+        words.push_back(line.substr(i, end - i));
+        i = end;
+    }
+    return true;
+}
+
+bool isQuoted(const std::string& word)
+{
+    return word.size() >= 2 && word.front() == '"' && word.back() == '"';
+}
+
+bool isIdentifier(const std::string& word)
+{
+    if (word.empty() || !(std::isalpha(static_cast<unsigned char>(word[0])) || word[0] == '_'))
+        return false;
+    return std::all_of(word.begin(), word.end(), [](char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    });
+}
+
+bool checkedMul(std::uint64_t a, std::uint64_t b, std::uint64_t& out)
+{
+    if (a != 0 && b > std::numeric_limits<std::uint64_t>::max() / a) return false;
+    out = a * b;
+    return true;
+}
+
+// mantissa * 10^exp10
+struct Decimal {
+    std::uint64_t mantissa = 0;
+    int exp10 = 0;
+};
+
+bool parseDecimal(std::string_view text, Decimal& d)
+{
+    d = {};
+    std::size_t i = 0;
+    bool digits = false;
+    bool point = false;
+    for (; i < text.size(); ++i) {
+        const char c = text[i];
+        if (c == '.' && !point) { point = true; continue; }
+        if (c < '0' || c > '9') break;
+        if (!checkedMul(d.mantissa, 10, d.mantissa) || d.mantissa > std::numeric_limits<std::uint64_t>::max() - 9)
+            return false;
+        d.mantissa += static_cast<std::uint64_t>(c - '0');
+        if (point) --d.exp10;
+        digits = true;
+    }
+    if (!digits) return false;
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        ++i;
+        bool negative = false;
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) negative = text[i++] == '-';
+        if (i == text.size()) return false;
+        int e = 0;
+        for (; i < text.size(); ++i) {
+            if (text[i] < '0' || text[i] > '9' || e > 1000) return false;
+            e = e * 10 + (text[i] - '0');
+        }
+        d.exp10 += negative ? -e : e;
+    }
+    return i == text.size();
+}
+
+// Product of '*'-separated decimals.
+bool parseProduct(std::string_view text, Decimal& d)
+{
+    d = { 1, 0 };
+    while (true) {
+        const std::size_t star = text.find('*');
+        Decimal factor;
+        if (!parseDecimal(text.substr(0, star), factor)) return false;
+        if (!checkedMul(d.mantissa, factor.mantissa, d.mantissa)) return false;
+        d.exp10 += factor.exp10;
+        if (star == std::string_view::npos) return true;
+        text.remove_prefix(star + 1);
+    }
+}
+
+// A double holds an integer exactly when its odd part fits in the 53-bit significand.
+bool exactInDouble(std::uint64_t v)
+{
+    while (v != 0 && (v & 1) == 0) v >>= 1;
+    return v < (std::uint64_t(1) << 53);
+}
+
+// [~][-]product[/product] -> exact Ratio, or the nearest one with the '~' prefix.
+bool parseValue(std::string_view text, Ratio& r, std::string& error)
+{
+    const bool approximate = !text.empty() && text.front() == '~';
+    if (approximate) text.remove_prefix(1);
+    const bool negative = !text.empty() && text.front() == '-';
+    if (negative) text.remove_prefix(1);
+
+    const std::size_t slash = text.find('/');
+    Decimal num, den{ 1, 0 };
+    if (!parseProduct(text.substr(0, slash), num)
+        || (slash != std::string_view::npos && !parseProduct(text.substr(slash + 1), den))) {
+        error = "malformed or out-of-range value '" + std::string(text) + "'";
+        return false;
+    }
+    if (den.mantissa == 0) { error = "division by zero"; return false; }
+
+    int exp10 = num.exp10 - den.exp10;
+    if (num.mantissa == 0) { r = { 0.0 }; return true; }
+    const std::uint64_t g = std::gcd(num.mantissa, den.mantissa);
+    num.mantissa /= g;
+    den.mantissa /= g;
+    while (num.mantissa % 10 == 0) { num.mantissa /= 10; ++exp10; }
+    while (den.mantissa % 10 == 0) { den.mantissa /= 10; --exp10; }
+
+    if (!approximate && !(exactInDouble(num.mantissa) && exactInDouble(den.mantissa))) {
+        error = "value '" + std::string(text) + "' has no exact double ratio; simplify it or prefix '~'";
+        return false;
+    }
+    const double n = static_cast<double>(num.mantissa);
+    r = { negative ? -n : n, static_cast<double>(den.mantissa), exp10 };
+    return true;
+}
+
+// "M*L^2/T^2" or "1/T" -> exponents of kBaseDimensions; each symbol may appear once.
+bool parseDimensions(std::string_view text, std::vector<int>& dims, std::string& error)
+{
+    dims.assign(kBaseDimensions.size(), 0);
+    const std::size_t slash = text.find('/');
+    int sign = 1;
+    for (std::string_view part = text.substr(0, slash);;) {
+        const std::size_t star = part.find('*');
+        const std::string_view factor = part.substr(0, star);
+        if (factor == "1" && part.size() == 1 && sign == 1 && slash != std::string_view::npos) { // "1/T"
+            part = text.substr(slash + 1);
+            sign = -1;
+            continue;
+        }
+        const std::size_t symbol = factor.empty() ? std::string_view::npos : kBaseDimensions.find(factor[0]);
+        const std::string_view power = factor.substr(std::min<std::size_t>(factor.size(), 2));
+        const bool ok = symbol != std::string_view::npos && dims[symbol] == 0
+                        && (factor.size() == 1 || (factor[1] == '^' && !power.empty() && power.size() < 3
+                            && std::all_of(power.begin(), power.end(), [](char c) { return c >= '0' && c <= '9'; })));
+        if (!ok) {
+            error = "malformed dimensions '" + std::string(text) + "' (symbols " + std::string(kBaseDimensions)
+                    + ", each once, with optional ^n, joined by '*' and at most one '/')";
+            return false;
+        }
+        dims[symbol] = sign * (factor.size() == 1 ? 1 : std::stoi(std::string(power)));
+
+        if (star != std::string_view::npos) {
+            part.remove_prefix(star + 1);
+        } else if (sign == 1 && slash != std::string_view::npos) {
+            part = text.substr(slash + 1);
+            sign = -1;
+        } else {
+            return true;
+        }
+    }
+}
+
+bool parseCatalog(const std::string& path, Catalog& catalog, std::string& error)
+{
+    std::ifstream in(path, std::ios::binary);
+    if (!in) { error = path + ": cannot open"; return false; }
+
+    std::unordered_map<std::string, std::size_t> idents;
+    std::string line;
+    std::vector<std::string> words;
+    for (int lineNo = 1; std::getline(in, line); ++lineNo) {
+        const std::string where = path + ":" + std::to_string(lineNo) + ": ";
+        if (!tokenize(line, words, error)) { error = where + error; return false; }
+        if (words.empty()) continue;
+
+        if (words[0] == "mode") {
+            if (words.size() != 4 || !isIdentifier(words[1]) || !isQuoted(words[2]) || words[3].rfind("dim=", 0) != 0) {
+                error = where + "expected: mode <Id> \"<display name>\" dim=<dimensions>";
+                return false;
+            }
+            if (!idents.emplace("mode " + words[1], 0).second) {
+                error = where + "duplicate mode " + words[1];
+                return false;
+            }
+            Mode m{ words[1], words[2].substr(1, words[2].size() - 2), catalog.units.size(), 0, 0, {} };
+            if (!parseDimensions(std::string_view(words[3]).substr(4), m.dims, error)) {
+                error = where + error;
+                return false;
+            }
+            catalog.modes.push_back(std::move(m));
+            continue;
+        }
+
+        if (words[0] != "unit") { error = where + "unknown directive '" + words[0] + "'"; return false; }
+        if (catalog.modes.empty()) { error = where + "unit before the first mode"; return false; }
+
+        Unit u;
+        std::size_t w = 1;
+        if (words.size() < 5 || !isIdentifier(words[1])) {
+            error = where + "expected: unit <Id> <key> <scale> [offset=<value>] \"<display name>\" [alias ...]";
+            return false;
+        }
+        u.ident = words[w++];
+        u.key = words[w++];
+        u.mode = catalog.modes.size() - 1;
+        if (!parseValue(words[w++], u.scale, error)) { error = where + error; return false; }
+        if (u.scale.num == 0.0) { error = where + "scale must not be zero"; return false; }
+        if (w < words.size() && words[w].rfind("offset=", 0) == 0) {
+            if (!parseValue(std::string_view(words[w++]).substr(7), u.offset, error)) {
+                error = where + error;
+                return false;
+            }
+        }
+        if (w == words.size() || !isQuoted(words[w])) { error = where + "missing display name"; return false; }
+        u.name = words[w].substr(1, words[w].size() - 2);
+        u.aliases.assign(words.begin() + static_cast<std::ptrdiff_t>(w) + 1, words.end());
+
+        if (!idents.emplace(u.ident, 0).second) { error = where + "duplicate unit " + u.ident; return false; }
+        ++catalog.modes.back().count;
+        catalog.units.push_back(std::move(u));
+    }
+
+    for (Mode& m : catalog.modes) {
+        if (m.count == 0) { error = path + ": mode " + m.ident + " has no units"; return false; }
+        const auto isBase = [](const Unit& u) {
+            return u.scale.num == 1.0 && u.scale.den == 1.0 && u.scale.exp10 == 0 && u.offset.num == 0.0;
+        };
+        const auto first = catalog.units.begin() + static_cast<std::ptrdiff_t>(m.first);
+        const auto base = std::find_if(first, first + static_cast<std::ptrdiff_t>(m.count), isBase);
+        if (base == first + static_cast<std::ptrdiff_t>(m.count)) {
+            error = path + ": mode " + m.ident + " has no base unit (scale 1, no offset)";
+            return false;
+        }
+        m.base = static_cast<std::size_t>(base - catalog.units.begin());
+    }
+    if (catalog.units.empty()) { error = path + ": no units"; return false; }
+    if (catalog.modes.size() > 255 || catalog.units.size() >= 0xFFFF) {
+        error = path + ": too many modes or units for the ID types";
+        return false;
+    }
+    return true;
+}
+
+// Names the runtime looks up: each unit's key and aliases.
+struct Name {
+    std::string text;
+    std::size_t unit;
+};
+
+bool collectNames(const Catalog& catalog, std::vector<Name>& names, std::string& error)
+{
+    std::unordered_map<std::string, std::size_t> seen;
+    for (std::size_t i = 0; i < catalog.units.size(); ++i) {
+        const Unit& u = catalog.units[i];
+        names.push_back({ u.key, i });
+        for (const std::string& a : u.aliases) names.push_back({ a, i });
+    }
+    for (const Name& n : names) {
+        const auto [it, inserted] = seen.emplace(n.text, n.unit);
+        if (!inserted) {
+            error = "name '" + n.text + "' is used by both " + catalog.units[it->second].ident
+                    + " and " + catalog.units[n.unit].ident;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Hash and displace: names are split into buckets by their hash, and each bucket, largest
+// first, gets the smallest displacement that sends all its names to free slots. With as
+// many slots as names the result is a minimal perfect hash.
+bool buildPerfectHash(const std::vector<Name>& names, std::vector<std::uint32_t>& displacements,
+                      std::vector<std::size_t>& slots)
+{
+    const std::size_t n = names.size();
+    std::vector<std::uint64_t> hashes(n);
+    for (std::size_t i = 0; i < n; ++i) hashes[i] = unitNameHash(names[i].text);
+
+    for (std::size_t bucketCount = std::max<std::size_t>(1, n / 4); bucketCount <= n; bucketCount *= 2) {
+        std::vector<std::vector<std::size_t>> buckets(bucketCount);
+        for (std::size_t i = 0; i < n; ++i) buckets[(hashes[i] >> 32) % bucketCount].push_back(i);
+
+        std::vector<std::size_t> order(bucketCount);
+        std::iota(order.begin(), order.end(), std::size_t(0));
+        std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+            return buckets[a].size() > buckets[b].size();
+        });
+
+        displacements.assign(bucketCount, 0);
+        slots.assign(n, n);
+        bool ok = true;
+        std::vector<std::size_t> taken;
+        for (const std::size_t b : order) {
+            if (buckets[b].empty()) break;
+            bool placed = false;
+            for (std::uint32_t d = 0; d < (1u << 20) && !placed; ++d) {
+                taken.clear();
+                placed = true;
+                for (const std::size_t i : buckets[b]) {
+                    const std::size_t s = unitNameSlotHash(hashes[i], d) % n;
+                    if (slots[s] != n || std::find(taken.begin(), taken.end(), s) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(s);
+                }
+                if (placed) {
+                    displacements[b] = d;
+                    for (std::size_t k = 0; k < taken.size(); ++k) slots[taken[k]] = buckets[b][k];
+                }
+            }
+            if (!placed) { ok = false; break; }
+        }
+        if (ok) return true;
+    }
+    return false;
+}
+
+// C++ string literal; non-ASCII bytes as octal escapes, which cannot run into the next character.
+std::string literal(const std::string& text)
+{
+    std::string out = "\"";
+    for (const char c : text) {
+        const unsigned char b = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (b < 0x20 || b >= 0x7F) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\%03o", b);
+            out += buf;
+        } else {
+            out += c;
+        }
+    }
+    return out + "\"";
+}
+
+std::string number(double v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.17g", v);
+    std::string s = buf;
+    if (s.find_first_of(".e") == std::string::npos) s += ".0";
+    return s;
+}
+
+std::string ratio(const Ratio& r)
+{
+    return "{ " + number(r.num) + ", " + number(r.den) + ", " + std::to_string(r.exp10) + " }";
+}
+
+std::string hexDouble(double v)
+{
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%a", v);
+    return buf;
+}
+
+const char* const kBanner = "// Generated by unitgen from units.catalog; do not edit.\n";
+
+std::string idsFile(const Catalog& c)
+{
+    std::ostringstream o;
+    o << kBanner
+      << "\n// Unit families, in catalogue order.\n"
+      << "enum class UnitMode : std::uint8_t {\n";
+    for (const Mode& m : c.modes) o << "    " << m.ident << ",\n";
+    o << "};\n"
+      << "inline constexpr std::size_t kModeCount = " << c.modes.size() << ";\n"
+      << "inline constexpr std::size_t kBaseDimensionCount = " << kBaseDimensions.size() << ";\n"
+      << "\n// Integer unit IDs, in catalogue order. Count is not a unit, Invalid marks a failed lookup.\n"
+      << "enum class UnitId : std::uint16_t {\n";
+    for (const Unit& u : c.units) o << "    " << u.ident << ",\n";
+    o << "    Count,\n"
+      << "    Invalid = 0xFFFF\n"
+      << "};\n";
+    return o.str();
+}
+
+std::string tablesFile(const Catalog& c, const std::vector<Name>& names,
+                       const std::vector<std::uint32_t>& displacements, const std::vector<std::size_t>& slots)
+{
+    std::ostringstream o;
+    o << kBanner << "\ninline constexpr std::string_view kModeNames[] = {\n";
+    for (const Mode& m : c.modes) o << "    " << literal(m.name) << ",\n";
+    o << "};\n\ninline constexpr UnitRange kModeRanges[] = {\n";
+    for (const Mode& m : c.modes) o << "    { " << m.first << ", " << m.count << " },\n";
+    o << "};\n\n// Unit each mode's scales and offsets are relative to.\n"
+      << "inline constexpr UnitId kModeBaseUnits[] = {\n";
+    for (const Mode& m : c.modes) o << "    UnitId::" << c.units[m.base].ident << ",\n";
+    o << "};\n\ninline constexpr std::string_view kBaseDimensionSymbols = " << literal(std::string(kBaseDimensions)) << ";\n"
+      << "\n// Each mode's dimensions; its base unit is the coherent unit of them.\n"
+      << "inline constexpr Dimensions kModeDimensions[] = {\n";
+    for (const Mode& m : c.modes) {
+        o << "    { {";
+        for (std::size_t i = 0; i < m.dims.size(); ++i) o << (i ? ", " : " ") << m.dims[i];
+        o << " } },\n";
+    }
+    o << "};\n\ninline constexpr UnitInfo kUnits[] = {\n";
+    for (const Unit& u : c.units) {
+        o << "    { UnitId::" << u.ident << ", UnitMode::" << c.modes[u.mode].ident << ", "
+          << literal(u.key) << ", " << literal(u.name) << ", " << ratio(u.scale) << ", " << ratio(u.offset) << " },\n";
+    }
+    o << "};\n";
+
+    std::size_t longest = 0;
+    for (const Name& n : names) longest = std::max(longest, n.text.size());
+    o << "\n// Minimal perfect hash over every key and alias (see unithash.h).\n"
+      << "inline constexpr std::size_t kUnitNameMaxBytes = " << longest << ";\n"
+      << "\ninline constexpr std::uint32_t kUnitNameDisplacements[] = {";
+    for (std::size_t i = 0; i < displacements.size(); ++i)
+        o << (i % 16 == 0 ? "\n    " : " ") << displacements[i] << ",";
+    o << "\n};\n\ninline constexpr UnitName kUnitNames[] = {\n";
+    for (const std::size_t s : slots) {
+        const Name& n = names[s];
+        o << "    { " << literal(n.text) << ", UnitId::" << c.units[n.unit].ident << " },\n";
+    }
+    o << "};\n";
+    return o.str();
+}
+
+std::string affineFile(const Catalog& c)
+{
+    std::ostringstream o;
+    o << kBanner << "\ninline constexpr ModeTable kModeTables[] = {\n";
+    std::size_t offset = 0;
+    for (const Mode& m : c.modes) {
+        o << "    { " << m.first << ", " << m.count << ", " << offset << " },\n";
+        offset += m.count * m.count;
+    }
+    o << "};\n\n// kAffineTable[tableOffset + i * count + j] converts unit first + i to unit first + j.\n"
+      << "inline constexpr Affine kAffineTable[] = {\n";
+    for (const Mode& m : c.modes) {
+        o << "    // " << m.ident << "\n";
+        for (std::size_t i = 0; i < m.count; ++i) {
+            for (std::size_t j = 0; j < m.count; ++j) {
+                const Affine a = foldAffine(c.units[m.first + i], c.units[m.first + j]);
+                o << "    { " << hexDouble(a.scale) << ", " << hexDouble(a.offset) << " },\n";
+            }
+        }
+    }
+    o << "};\n";
+    return o.str();
+}
+
+bool writeIfChanged(const std::string& path, const std::string& content, std::string& error)
+{
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (in) {
+            const std::string old((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+            if (old == content) return true;
+        }
+    }
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out << content;
+    if (!out.flush()) { error = path + ": write failed"; return false; }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc != 3) {
+        std::fprintf(stderr, "usage: unitgen <units.catalog> <output directory>\n");
+        return 2;
+    }
+
+    Catalog catalog;
+    std::vector<Name> names;
+    std::vector<std::uint32_t> displacements;
+    std::vector<std::size_t> slots;
+    std::string error;
+    if (!parseCatalog(argv[1], catalog, error) || !collectNames(catalog, names, error)) {
+        std::fprintf(stderr, "unitgen: %s\n", error.c_str());
+        return 1;
+    }
+    if (!buildPerfectHash(names, displacements, slots)) {
+        std::fprintf(stderr, "unitgen: no perfect hash found for %zu names\n", names.size());
+        return 1;
+    }
+
+    const std::string dir = std::string(argv[2]) + "/";
+    if (!writeIfChanged(dir + "unitcatalog_ids.inc", idsFile(catalog), error)
+        || !writeIfChanged(dir + "unitcatalog_tables.inc", tablesFile(catalog, names, displacements, slots), error)
+        || !writeIfChanged(dir + "unitcatalog_affine.inc", affineFile(catalog), error)) {
+        std::fprintf(stderr, "unitgen: %s\n", error.c_str());
+        return 1;
+    }
+    return 0;
+}
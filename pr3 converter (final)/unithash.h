@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// Hashes behind the unit-name perfect hash. unitgen searches the per-bucket displacements
+// with these exact functions, so changing either one only takes a rebuild.
+//
+//     bucket = (unitNameHash(name) >> 32) % bucketCount
+//     slot   = unitNameSlotHash(unitNameHash(name), displacement[bucket]) % nameCount
+
+// FNV-1a over the name's UTF-8 bytes.
+constexpr std::uint64_t unitNameHash(std::string_view name)
+{
+    std::uint64_t h = 0xcbf29ce484222325ull;
+    for (const char c : name) {
+        h ^= static_cast<unsigned char>(c);
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+// Re-mixes a name hash with its bucket's displacement (splitmix64 finaliser).
+constexpr std::uint64_t unitNameSlotHash(std::uint64_t h, std::uint32_t displacement)
+{
+    std::uint64_t x = h + (std::uint64_t(displacement) + 1) * 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
@@ -0,0 +1,208 @@
+#include "unitindex.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr float kPrefixBase = 0.6f;   // + up to 0.3 for how much of the name the prefix covers
+constexpr float kTrigramWeight = 0.8f; // times the Dice coefficient of the trigram sets
+
+// Longest query that is matched; anything longer is no unit name.
+constexpr std::size_t kMaxQueryBytes = 64;
+
+char fold(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? char(c - 'A' + 'a') : c;
+}
+
+// Distinct trigrams of " name ", packed into 24 bits, sorted.
+void trigramsOf(std::string_view folded, std::vector<std::uint32_t>& out)
+{
+    out.clear();
+    const auto at = [&](std::size_t i) -> std::uint32_t {
+        return (i == 0 || i > folded.size()) ? ' ' : static_cast<unsigned char>(folded[i - 1]);
+    };
+    for (std::size_t i = 0; i + 3 <= folded.size() + 2; ++i)
+        out.push_back(at(i) << 16 | at(i + 1) << 8 | at(i + 2));
+    std::sort(out.begin(), out.end());
+    out.erase(std::unique(out.begin(), out.end()), out.end());
+}
+
+class NameIndex
+{
+public:
+    struct Entry {
+        std::string folded;
+        UnitId id;
+        std::uint16_t trigrams;
+    };
+
+    NameIndex()
+    {
+        const auto add = [this](std::string_view name, UnitId id) {
+            std::string folded(name);
+            std::transform(folded.begin(), folded.end(), folded.begin(), fold);
+            entries_.push_back({ std::move(folded), id, 0 });
+        };
+        for (const UnitName& n : kUnitNames) add(n.text, n.id);
+        for (const UnitInfo& u : kUnits) add(u.name, u.id);
+
+        std::sort(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+            return a.folded != b.folded ? a.folded < b.folded : a.id < b.id;
+        });
+        entries_.erase(std::unique(entries_.begin(), entries_.end(), [](const Entry& a, const Entry& b) {
+            return a.folded == b.folded && a.id == b.id;
+        }), entries_.end());
+
+        std::vector<std::uint32_t> tris;
+        for (std::size_t e = 0; e < entries_.size(); ++e) {
+            trigramsOf(entries_[e].folded, tris);
+            entries_[e].trigrams = static_cast<std::uint16_t>(tris.size());
+            for (const std::uint32_t t : tris) postings_.push_back(std::uint64_t(t) << 32 | e);
+        }
+        std::sort(postings_.begin(), postings_.end());
+    }
+
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    // Entries whose folded name starts with prefix.
+    std::pair<std::size_t, std::size_t> prefixRange(std::string_view prefix) const
+    {
+        const auto first = std::lower_bound(entries_.begin(), entries_.end(), prefix,
+                                            [](const Entry& e, std::string_view p) { return e.folded < p; });
+        auto last = first;
+        while (last != entries_.end() && std::string_view(last->folded).substr(0, prefix.size()) == prefix)
+            ++last;
+        return { std::size_t(first - entries_.begin()), std::size_t(last - entries_.begin()) };
+    }
+
+    // Calls fn(entry) for every entry containing trigram t.
+    template <typename Fn>
+    void forEachPosting(std::uint32_t t, Fn fn) const
+    {
+        auto it = std::lower_bound(postings_.begin(), postings_.end(), std::uint64_t(t) << 32);
+        for (; it != postings_.end() && (*it >> 32) == t; ++it)
+            fn(static_cast<std::size_t>(*it & 0xFFFFFFFFu));
+    }
+
+private:
+    std::vector<Entry> entries_;          // sorted by folded name
+    std::vector<std::uint64_t> postings_; // trigram << 32 | entry, sorted
+};
+
+const NameIndex& nameIndex()
+{
+    static const NameIndex index;
+    return index;
+}
+
+// Keeps the best maxOut matches, one per unit, ordered by score.
+class TopMatches
+{
+public:
+    TopMatches(UnitMatch* out, std::size_t maxOut) : out_(out), max_(maxOut) {}
+
+    void offer(UnitId id, float score)
+    {
+        std::size_t i = 0;
+        while (i < size_ && out_[i].id != id) ++i;
+        if (i < size_) {
+            if (out_[i].score >= score) return;
+        } else if (size_ < max_) {
+            i = size_++;
+        } else if (max_ != 0 && out_[max_ - 1].score < score) {
+            i = max_ - 1;
+        } else {
+            return;
+        }
+        out_[i] = { id, score };
+        for (; i > 0 && out_[i - 1].score < out_[i].score; --i) std::swap(out_[i - 1], out_[i]);
+    }
+
+    std::size_t size() const { return size_; }
+
+private:
+    UnitMatch* out_;
+    std::size_t max_;
+    std::size_t size_ = 0;
+};
+
+} // namespace
+
+std::size_t matchUnitName(std::string_view text, UnitMatch* out, std::size_t maxOut, std::optional<UnitMode> mode)
+{
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t')) text.remove_suffix(1);
+    if (text.empty() || text.size() > kMaxQueryBytes || maxOut == 0) return 0;
+
+    const auto inMode = [&](UnitId id) { return !mode || unitInfo(id).mode == *mode; };
+    TopMatches top(out, maxOut);
+
+    if (const UnitId id = unitIdFromKey(text); isValidUnit(id) && inMode(id))
+        top.offer(id, 1.0f);
+
+    char foldedBuf[kMaxQueryBytes];
+    std::transform(text.begin(), text.end(), foldedBuf, fold);
+    const std::string_view query(foldedBuf, text.size());
+
+    const NameIndex& index = nameIndex();
+    const auto& entries = index.entries();
+
+    const auto [first, last] = index.prefixRange(query);
+    for (std::size_t e = first; e < last; ++e) {
+        const NameIndex::Entry& entry = entries[e];
+        if (!inMode(entry.id)) continue;
+        const float cover = float(query.size()) / float(entry.folded.size());
+        top.offer(entry.id, cover == 1.0f ? kExactNameScore : kPrefixBase + 0.3f * cover);
+    }
+
+    // Trigram overlap catches typos and infixes; one-letter queries only match by prefix.
+    if (query.size() < 2) return top.size();
+
+    thread_local std::vector<std::uint8_t> shared;
+    thread_local std::vector<std::size_t> touched;
+    thread_local std::vector<std::uint32_t> tris;
+    shared.resize(entries.size());
+    touched.clear();
+    trigramsOf(query, tris);
+    for (const std::uint32_t t : tris) {
+        index.forEachPosting(t, [&](std::size_t e) {
+            if (shared[e]++ == 0) touched.push_back(e);
+        });
+    }
+    for (const std::size_t e : touched) {
+        const NameIndex::Entry& entry = entries[e];
+        const float dice = 2.0f * float(shared[e]) / float(tris.size() + entry.trigrams);
+        shared[e] = 0;
+        if (inMode(entry.id)) top.offer(entry.id, kTrigramWeight * dice);
+    }
+    return top.size();
+}
+
+UnitId bestUnitMatch(std::string_view text, std::optional<UnitMode> mode, float minScore)
+{
+    UnitMatch best;
+    if (matchUnitName(text, &best, 1, mode) == 0 || best.score < minScore) return UnitId::Invalid;
+    return best.id;
+}
+
+UnitId exactUnitName(std::string_view text)
+{
+    if (const UnitId id = unitIdFromKey(text); isValidUnit(id)) return id;
+    if (text.empty() || text.size() > kMaxQueryBytes) return UnitId::Invalid;
+
+    char foldedBuf[kMaxQueryBytes];
+    std::transform(text.begin(), text.end(), foldedBuf, fold);
+    const std::string_view query(foldedBuf, text.size());
+
+    // entries are sorted by folded name, so the exact ones lead the prefix range
+    const auto& entries = nameIndex().entries();
+    UnitId found = UnitId::Invalid;
+    for (std::size_t e = nameIndex().prefixRange(query).first; e < entries.size() && entries[e].folded == query; ++e) {
+        if (found != UnitId::Invalid && entries[e].id != found) return UnitId::Invalid;
+        found = entries[e].id;
+    }
+    return found;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include "unitregistry.h"
+
+struct UnitMatch {
+    UnitId id = UnitId::Invalid;
+    float score = 0.0f; // 1 for an exact key or alias, less for folded, prefix and trigram matches
+};
+
+// Exact keys and aliases score 1, case-folded exact names score at least this much.
+inline constexpr float kExactNameScore = 0.95f;
+
+// Matches below this score are typos too far from any unit name to be trusted.
+inline constexpr float kMinUnitMatchScore = 0.4f;
+
+// Forgiving lookup of typed unit names ("ft", "Feet", "kilomet", "farenheit") over every key,
+// alias and display name in the catalogue. A case-folded prefix index and a trigram index
+// are built on first use, so a query touches only the names that share a prefix or trigram
+// with it, however large the catalogue. Thread-safe.
+//
+// Writes up to maxOut matches into out, best first and one per unit, and returns how many.
+// With mode set, units of other modes are skipped.
+std::size_t matchUnitName(std::string_view text, UnitMatch* out, std::size_t maxOut,
+                          std::optional<UnitMode> mode = std::nullopt);
+
+// The best match scoring at least minScore, or UnitId::Invalid.
+UnitId bestUnitMatch(std::string_view text, std::optional<UnitMode> mode = std::nullopt,
+                     float minScore = kMinUnitMatchScore);
+
+// Strict lookup for unit expressions: an exact key or alias, else the one unit with a key,
+// alias or name equal to text ignoring case. UnitId::Invalid when none is, and when several
+// are ("mB": millibar, megabyte or megabit), rather than picking one of them.
+UnitId exactUnitName(std::string_view text);
@@ -0,0 +1,35 @@
+#include "unitlistmodel.h"
+
+UnitListModel::UnitListModel(UnitMode mode, QObject *parent)
+    : QAbstractListModel(parent)
+    , range_(unitRange(mode))
+{
+}
+
+int UnitListModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : int(range_.count);
+}
+
+QVariant UnitListModel::data(const QModelIndex &index, int role) const
+{
+    const UnitId id = unitAt(index.row());
+    if (!index.isValid() || !isValidUnit(id)) return {};
+
+    const UnitInfo& u = unitInfo(id);
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString::fromUtf8(u.name.data(), qsizetype(u.name.size())) + QStringLiteral(" (")
+               + QString::fromUtf8(u.key.data(), qsizetype(u.key.size())) + QLatin1Char(')');
+    case UnitIdRole:
+        return QVariant::fromValue(static_cast<int>(id));
+    default:
+        return {};
+    }
+}
+
+UnitId UnitListModel::unitAt(int row) const
+{
+    if (row < 0 || std::size_t(row) >= range_.count) return UnitId::Invalid;
+    return static_cast<UnitId>(range_.first + std::size_t(row));
+}
@@ -0,0 +1,29 @@
+#ifndef UNITLISTMODEL_H
+#define UNITLISTMODEL_H
+
+#include <QAbstractListModel>
+
+#include "unitregistry.h"
+
+// The units of one mode, straight from the registry: row i is unit first + i. Item text
+// ("meters (m)") is built on demand, so a combo only pays for the rows it shows.
+class UnitListModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    static constexpr int UnitIdRole = Qt::UserRole;
+
+    explicit UnitListModel(UnitMode mode, QObject *parent = nullptr);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+    // UnitId::Invalid for rows outside the model (e.g. a combo's -1).
+    UnitId unitAt(int row) const;
+
+private:
+    UnitRange range_;
+};
+
+#endif // UNITLISTMODEL_H
@@ -0,0 +1,116 @@
+#pragma once
+#include <cstddef>
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include "affine.h"
+#include "unithash.h"
+
+// The units are declared in units.catalog and compiled by unitgen into the .inc tables
+// included below, so startup does no parsing. Converter::Mode is an alias of UnitMode,
+// so the registry can be used without Qt.
+
+// UnitMode, kModeCount, kBaseDimensionCount, UnitId
+#include "unitcatalog_ids.inc"
+
+// Exponents of the base dimensions (kBaseDimensionSymbols: length, mass, time, temperature,
+// data, angle), from each mode's dim= in units.catalog.
+struct Dimensions {
+    std::array<std::int8_t, kBaseDimensionCount> exponent{};
+
+    friend constexpr bool operator==(const Dimensions&, const Dimensions&) = default;
+};
+
+// base = value * scale + offset, where the base is the mode's unit with scale 1
+struct UnitInfo {
+    UnitId id;
+    UnitMode mode;
+    std::string_view key;
+    std::string_view name;
+    Ratio scale;
+    Ratio offset;
+};
+
+// Units of one mode occupy a contiguous run of IDs.
+struct UnitRange {
+    std::size_t first = 0;
+    std::size_t count = 0;
+};
+
+// One slot of the perfect hash from unit keys and aliases to IDs.
+struct UnitName {
+    std::string_view text;
+    UnitId id;
+};
+
+// kModeNames, kModeRanges, kModeBaseUnits, kBaseDimensionSymbols, kModeDimensions, kUnits, kUnitNameMaxBytes, kUnitNameDisplacements, kUnitNames
+#include "unitcatalog_tables.inc"
+
+inline constexpr std::size_t kUnitCount = static_cast<std::size_t>(UnitId::Count);
+static_assert(sizeof(kUnits) / sizeof(kUnits[0]) == kUnitCount, "kUnits must list every UnitId");
+static_assert(sizeof(kModeRanges) / sizeof(kModeRanges[0]) == kModeCount, "kModeRanges must list every mode");
+static_assert(kBaseDimensionSymbols.size() == kBaseDimensionCount, "one symbol per base dimension");
+
+constexpr bool isValidMode(UnitMode mode)
+{
+    return static_cast<std::size_t>(mode) < kModeCount;
+}
+
+constexpr std::string_view unitModeName(UnitMode mode)
+{
+    return isValidMode(mode) ? kModeNames[static_cast<std::size_t>(mode)] : std::string_view();
+}
+
+constexpr UnitRange unitRange(UnitMode mode)
+{
+    return isValidMode(mode) ? kModeRanges[static_cast<std::size_t>(mode)] : UnitRange();
+}
+
+// The mode's unit with scale 1 and no offset (meter, kilogram, Kelvin, ...).
+constexpr UnitId baseUnit(UnitMode mode)
+{
+    return isValidMode(mode) ? kModeBaseUnits[static_cast<std::size_t>(mode)] : UnitId::Invalid;
+}
+
+constexpr const Dimensions& modeDimensions(UnitMode mode)
+{
+    return kModeDimensions[static_cast<std::size_t>(mode)];
+}
+
+// First mode with exactly these dimensions, if any (N·m finds Energy, mi/gal finds none).
+constexpr std::optional<UnitMode> modeForDimensions(const Dimensions& dims)
+{
+    for (std::size_t m = 0; m < kModeCount; ++m) {
+        if (kModeDimensions[m] == dims) return static_cast<UnitMode>(m);
+    }
+    return std::nullopt;
+}
+
+constexpr bool isValidUnit(UnitId id)
+{
+    return static_cast<std::size_t>(id) < kUnitCount;
+}
+
+constexpr const UnitInfo& unitInfo(UnitId id)
+{
+    return kUnits[static_cast<std::size_t>(id)];
+}
+
+// Position of a unit within its mode's range.
+constexpr std::size_t unitIndexInMode(UnitId id)
+{
+    return static_cast<std::size_t>(id) - unitRange(unitInfo(id).mode).first;
+}
+
+// Key or alias (UTF-8, case-sensitive) to ID: one hash of the name, one displacement
+// lookup and one comparison, whatever the catalogue's size.
+constexpr UnitId unitIdFromKey(std::string_view key)
+{
+    constexpr std::size_t kBuckets = sizeof(kUnitNameDisplacements) / sizeof(kUnitNameDisplacements[0]);
+    constexpr std::size_t kNames = sizeof(kUnitNames) / sizeof(kUnitNames[0]);
+
+    const std::uint64_t h = unitNameHash(key);
+    const UnitName& slot = kUnitNames[unitNameSlotHash(h, kUnitNameDisplacements[(h >> 32) % kBuckets]) % kNames];
+    return slot.text == key ? slot.id : UnitId::Invalid;
+}